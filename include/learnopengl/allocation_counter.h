@@ -0,0 +1,13 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// Heap allocations made through operator new, counted per thread. The counting replacements of the
+// global operator new and delete are in src/allocation_counter.cpp and apply to the whole program, so
+// a frame can check that it left the heap alone by comparing Count before and after it on the GL thread.
+struct AllocationCounter
+{
+    // allocations the calling thread has made since it started
+    static unsigned long long Count();
+};
+
+#endif
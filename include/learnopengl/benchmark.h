@@ -0,0 +1,123 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <learnopengl/gpu_timer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-frame CPU and GPU times of a benchmark run as measured by the Profiler, written out as JSON:
+//   { "frames": N, "allocatingFrames": N, "cpu": {summary}, "gpu": {summary},
+//     "scopes": [{"name", "cpu", "gpu"}...], "perFrame": [{"cpu", "gpu", "allocations"}...] }
+// where a summary holds mean, min, max and the 50th, 90th, 95th and 99th percentile in milliseconds.
+// Scopes are summed per frame by name, like the profiler's graphs.
+class BenchmarkReport
+{
+public:
+    // records the frame the profiler collected last and the heap allocations it made
+    void AddFrame(const Profiler &profiler, unsigned long long allocations)
+    {
+        frameCpuMs.push_back(profiler.FrameCpuMs());
+        frameGpuMs.push_back(profiler.FrameGpuMs());
+        frameAllocations.push_back(allocations);
+        size_t frame = frameCpuMs.size() - 1;
+        for (const ProfileScopeResult &result: profiler.Results())
+        {
+            Scope &scope = scopeOf(result.name);
+            scope.cpuMs.resize(frame + 1, 0.0f);
+            scope.gpuMs.resize(frame + 1, 0.0f);
+            scope.cpuMs[frame] += result.cpuMs;
+            scope.gpuMs[frame] += result.gpuMs;
+        }
+    }
+
+    size_t FrameCount() const
+    {
+        return frameCpuMs.size();
+    }
+
+    // frames that made any heap allocation, 0 in a steady state
+    size_t AllocatingFrames() const
+    {
+        return frameAllocations.size() - std::count(frameAllocations.begin(), frameAllocations.end(), 0ull);
+    }
+
+    void WriteJson(std::ostream &out) const
+    {
+        out << "{\n  \"frames\": " << frameCpuMs.size() << ",\n";
+        out << "  \"allocatingFrames\": " << AllocatingFrames() << ",\n";
+        out << "  \"cpu\": ";
+        writeSummary(out, frameCpuMs);
+        out << ",\n  \"gpu\": ";
+        writeSummary(out, frameGpuMs);
+        out << ",\n  \"scopes\": [";
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            // frames after the last one a scope appeared in count as 0
+            std::vector<float> cpuMs = scopes[i].cpuMs, gpuMs = scopes[i].gpuMs;
+            cpuMs.resize(frameCpuMs.size(), 0.0f);
+            gpuMs.resize(frameGpuMs.size(), 0.0f);
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << scopes[i].name << "\", \"cpu\": ";
+            writeSummary(out, cpuMs);
+            out << ", \"gpu\": ";
+            writeSummary(out, gpuMs);
+            out << "}";
+        }
+        out << "\n  ],\n  \"perFrame\": [";
+        for (size_t i = 0; i < frameCpuMs.size(); i++)
+            out << (i ? ",\n" : "\n") << "    {\"cpu\": " << frameCpuMs[i] << ", \"gpu\": " << frameGpuMs[i]
+                << ", \"allocations\": " << frameAllocations[i] << "}";
+        out << "\n  ]\n}\n";
+    }
+
+    // nearest-rank percentile of values, 0 for none
+    static float Percentile(std::vector<float> values, float percent)
+    {
+        if (values.empty())
+            return 0.0f;
+        std::sort(values.begin(), values.end());
+        size_t rank = (size_t) std::ceil(percent / 100.0f * values.size());
+        return values[std::min(std::max(rank, (size_t) 1), values.size()) - 1];
+    }
+
+private:
+    struct Scope {
+        const char *name;
+        std::vector<float> cpuMs;
+        std::vector<float> gpuMs;
+    };
+
+    std::vector<float> frameCpuMs;
+    std::vector<float> frameGpuMs;
+    std::vector<unsigned long long> frameAllocations;
+    std::vector<Scope> scopes;
+
+    Scope &scopeOf(const char *name)
+    {
+        for (Scope &scope: scopes)
+            if (scope.name == name || std::strcmp(scope.name, name) == 0)
+                return scope;
+        scopes.push_back(Scope{name, {}, {}});
+        return scopes.back();
+    }
+
+    static void writeSummary(std::ostream &out, const std::vector<float> &values)
+    {
+        float sum = 0.0f;
+        for (float value: values)
+            sum += value;
+        out << "{\"mean\": " << (values.empty() ? 0.0f : sum / values.size())
+            << ", \"min\": " << (values.empty() ? 0.0f : *std::min_element(values.begin(), values.end()))
+            << ", \"max\": " << (values.empty() ? 0.0f : *std::max_element(values.begin(), values.end()))
+            << ", \"p50\": " << Percentile(values, 50.0f)
+            << ", \"p90\": " << Percentile(values, 90.0f)
+            << ", \"p95\": " << Percentile(values, 95.0f)
+            << ", \"p99\": " << Percentile(values, 99.0f) << "}";
+    }
+};
+
+#endif
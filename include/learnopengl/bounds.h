@@ -0,0 +1,142 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// axis aligned bounding box, empty (min > max) until the first point is added
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsEmpty() const
+    {
+        return min.x > max.x;
+    }
+
+    void Expand(const glm::vec3 &point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Expand(const AABB &box)
+    {
+        if (box.IsEmpty())
+            return;
+        Expand(box.min);
+        Expand(box.max);
+    }
+
+    glm::vec3 Center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 Extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    // box around the transformed box (Arvo), the extents are projected on the absolute axes of the matrix
+    AABB Transformed(const glm::mat4 &matrix) const
+    {
+        if (IsEmpty())
+            return *this;
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(Center(), 1.0f));
+        glm::vec3 extents = Extents();
+        glm::vec3 newExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+                               glm::abs(glm::vec3(matrix[1])) * extents.y +
+                               glm::abs(glm::vec3(matrix[2])) * extents.z;
+        AABB box;
+        box.min = center - newExtents;
+        box.max = center + newExtents;
+        return box;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = -1.0f;
+
+    bool IsEmpty() const
+    {
+        return radius < 0.0f;
+    }
+
+    // sphere around the transformed sphere, non-uniform scale grows it by the largest axis scale
+    BoundingSphere Transformed(const glm::mat4 &matrix) const
+    {
+        BoundingSphere sphere;
+        sphere.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+        float scale = std::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                      std::max(glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+                               glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+        sphere.radius = radius * std::sqrt(scale);
+        return sphere;
+    }
+};
+
+// Frustum planes extracted from a view-projection matrix (Gribb/Hartmann). Each plane is stored as
+// (normal, distance) with the normal pointing into the frustum.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4 &viewProjection)
+    {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0]; // left
+        frustum.planes[1] = rows[3] - rows[0]; // right
+        frustum.planes[2] = rows[3] + rows[1]; // bottom
+        frustum.planes[3] = rows[3] - rows[1]; // top
+        frustum.planes[4] = rows[3] + rows[2]; // near
+        frustum.planes[5] = rows[3] - rows[2]; // far
+        for (glm::vec4 &plane: frustum.planes)
+            plane *= 1.0f / glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    // conservative: may report a sphere near a frustum corner as visible, never the other way around
+    bool Intersects(const BoundingSphere &sphere) const
+    {
+        for (const glm::vec4 &plane: planes)
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        return true;
+    }
+
+    bool Intersects(const AABB &box) const
+    {
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        for (const glm::vec4 &plane: planes) {
+            glm::vec3 normal = glm::vec3(plane);
+            // distance of the corner furthest along the plane normal
+            if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extents) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+// what the culling tests let through, summed over a pass
+struct CullStats {
+    unsigned int objectsDrawn = 0;
+    unsigned int objectsCulled = 0;
+    unsigned int meshesDrawn = 0;
+    unsigned int meshesCulled = 0;
+    // skipped because their last occlusion query found them hidden
+    unsigned int objectsOccluded = 0;
+    unsigned int trianglesDrawn = 0;
+    // objects drawn as billboards, also counted in objectsDrawn
+    unsigned int impostorsDrawn = 0;
+};
+
+#endif
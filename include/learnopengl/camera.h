@@ -23,6 +23,16 @@ const float SENSITIVITY =  0.1f;
 const float ZOOM        =  45.0f;
 const float HEIGHT      =  6.0f;
 const float STEP_DELTA  =  0.15f;
+
+// what input changes on a camera, enough to put it back where it was
+struct CameraState {
+    glm::vec3 Position;
+    float Yaw;
+    float Pitch;
+    float Zoom;
+    float TimeSpentWalking;
+};
+
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
 class Camera
 {
@@ -110,6 +120,27 @@ public:
         updateCameraVectors();
     }
 
+    // points the camera along the given Euler angles, for scripted cameras
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
+    CameraState GetState() const
+    {
+        return CameraState{Position, Yaw, Pitch, Zoom, timeSpentWalking};
+    }
+
+    void SetState(const CameraState &state)
+    {
+        Position = state.Position;
+        Zoom = state.Zoom;
+        timeSpentWalking = state.TimeSpentWalking;
+        SetOrientation(state.Yaw, state.Pitch);
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
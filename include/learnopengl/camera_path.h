@@ -0,0 +1,117 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A camera flight through key poses, played back as a Catmull-Rom spline through the positions and the
+// yaw/pitch angles with the keys evenly spaced in time. Paths are recorded by adding the live camera and
+// saved as text, one "x y z yaw pitch" key per line.
+class CameraPath
+{
+public:
+    struct Key {
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    // a scripted loop: keyCount poses on a circle around center, alternating between two heights and
+    // looking at the center
+    static CameraPath Orbit(const glm::vec3 &center, float radius, float lowHeight, float highHeight, int keyCount = 8)
+    {
+        CameraPath path;
+        for (int i = 0; i <= keyCount; i++)
+        {
+            float angle = glm::radians(360.0f * i / keyCount);
+            glm::vec3 position = center + glm::vec3(radius * std::cos(angle), i % 2 ? highHeight : lowHeight, radius * std::sin(angle));
+            glm::vec3 front = glm::normalize(center - position);
+            path.keys.push_back(Key{position, glm::degrees(std::atan2(front.z, front.x)), glm::degrees(std::asin(front.y))});
+        }
+        return path;
+    }
+
+    // replaces the keys with the ones in a file written by Save, false if it cannot be read or holds none
+    bool Load(const std::string &filename)
+    {
+        std::ifstream in(filename);
+        std::vector<Key> loaded;
+        Key key;
+        while (in >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)
+            loaded.push_back(key);
+        if (loaded.empty())
+            return false;
+        keys.swap(loaded);
+        return true;
+    }
+
+    void Save(const std::string &filename) const
+    {
+        std::ofstream out(filename);
+        for (const Key &key: keys)
+            out << key.position.x << ' ' << key.position.y << ' ' << key.position.z << ' ' << key.yaw << ' ' << key.pitch << '\n';
+    }
+
+    void Add(const Camera &camera)
+    {
+        keys.push_back(Key{camera.Position, camera.Yaw, camera.Pitch});
+    }
+
+    size_t KeyCount() const
+    {
+        return keys.size();
+    }
+
+    // moves camera to the pose at t, 0 being the first key and 1 the last
+    void Apply(float t, Camera &camera) const
+    {
+        if (keys.empty())
+            return;
+        float position = glm::clamp(t, 0.0f, 1.0f) * (keys.size() - 1);
+        int segment = std::min((int) position, (int) keys.size() - 2);
+        if (segment < 0)
+        {
+            camera.Position = keys[0].position;
+            camera.SetOrientation(keys[0].yaw, keys[0].pitch);
+            return;
+        }
+        float u = position - segment;
+        const Key &p0 = keys[std::max(segment - 1, 0)];
+        const Key &p1 = keys[segment];
+        const Key &p2 = keys[segment + 1];
+        const Key &p3 = keys[std::min(segment + 2, (int) keys.size() - 1)];
+        camera.Position = catmullRom(p0.position, p1.position, p2.position, p3.position, u);
+        // angles are unwrapped against p1 so a turn through +-180 degrees takes the short way
+        float yaw1 = p1.yaw;
+        float yaw0 = yaw1 + wrap(p0.yaw - yaw1);
+        float yaw2 = yaw1 + wrap(p2.yaw - yaw1);
+        float yaw3 = yaw2 + wrap(p3.yaw - yaw2);
+        float yaw = catmullRom(glm::vec3(yaw0), glm::vec3(yaw1), glm::vec3(yaw2), glm::vec3(yaw3), u).x;
+        float pitch = catmullRom(glm::vec3(p0.pitch), glm::vec3(p1.pitch), glm::vec3(p2.pitch), glm::vec3(p3.pitch), u).x;
+        camera.SetOrientation(yaw, glm::clamp(pitch, -89.0f, 89.0f));
+    }
+
+private:
+    std::vector<Key> keys;
+
+    static glm::vec3 catmullRom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float u)
+    {
+        float u2 = u * u, u3 = u2 * u;
+        return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    }
+
+    // angle in degrees mapped to [-180, 180)
+    static float wrap(float degrees)
+    {
+        return degrees - 360.0f * std::floor((degrees + 180.0f) / 360.0f);
+    }
+};
+
+#endif
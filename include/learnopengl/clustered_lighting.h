@@ -0,0 +1,274 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/lights.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Clustered forward lighting. The view frustum is split into GRID_X x GRID_Y screen tiles and GRID_Z
+// exponentially spaced depth slices. Every frame the point lights are binned into the clusters their
+// sphere of influence touches, and the lit shaders only loop over the lights of their fragment's cluster.
+//
+// All data reaches the shaders through texture buffers (GL 3.3 has no SSBOs):
+//   pointLightData  RGBA32F, 4 texels per light laid out like PointLight
+//   clusterData     RG32UI,  (first index, light count) per cluster
+//   lightIndexData  R32UI,   light indices of all clusters back to back
+// The grid dimensions and depth slice parameters go out with the Lights uniform block, see Grid().
+class ClusteredLighting
+{
+public:
+    static const int GRID_X = 16;
+    static const int GRID_Y = 9;
+    static const int GRID_Z = 24;
+    static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    // texture units the buffers are bound to, chosen above anything the materials use
+    static const int LIGHT_DATA_UNIT = 8;
+    static const int CLUSTER_DATA_UNIT = 9;
+    static const int LIGHT_INDEX_UNIT = 10;
+
+    // a light is culled where its brightest channel falls below this fraction of its full intensity
+    static constexpr float ATTENUATION_CUTOFF = 1.0f / 64.0f;
+
+    ClusteredLighting()
+    {
+        createBuffer(lightBuffer, lightTexture, GL_RGBA32F);
+        createBuffer(clusterBuffer, clusterTexture, GL_RG32UI);
+        createBuffer(indexBuffer, indexTexture, GL_R32UI);
+    }
+
+    ~ClusteredLighting()
+    {
+        GLuint buffers[] = {lightBuffer, clusterBuffer, indexBuffer};
+        GLuint textures[] = {lightTexture, clusterTexture, indexTexture};
+        glDeleteBuffers(3, buffers);
+        GLState::Get().DeleteTextures(3, textures);
+    }
+
+    ClusteredLighting(const ClusteredLighting &) = delete;
+    ClusteredLighting &operator=(const ClusteredLighting &) = delete;
+
+    // points the sampler uniforms of a lit shader at the texture units, call once after linking
+    void SetupShader(Shader &shader) const
+    {
+        shader.use();
+        shader.setInt("pointLightData", LIGHT_DATA_UNIT);
+        shader.setInt("clusterData", CLUSTER_DATA_UNIT);
+        shader.setInt("lightIndexData", LIGHT_INDEX_UNIT);
+    }
+
+    // distance at which the light's contribution drops to ATTENUATION_CUTOFF, the shaders fade it out to
+    // zero there so culling at that range leaves no visible seam
+    static float LightRadius(const PointLight &light)
+    {
+        glm::vec3 intensity = light.ambient + light.diffuse + light.specular;
+        float peak = std::max(intensity.x, std::max(intensity.y, intensity.z));
+        // solve constant + linear * d + quadratic * d^2 = peak / cutoff for d
+        float c = light.constant - peak / ATTENUATION_CUTOFF;
+        if (c >= 0.0f)
+            return 0.0f;
+        if (light.quadratic > 0.0f)
+            return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+        if (light.linear > 0.0f)
+            return -c / light.linear;
+        return INFINITY;
+    }
+
+    // bins the lights for the current camera and uploads everything the shaders read
+    void Update(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovy, float aspect,
+                float zNear, float zFar, int screenWidth, int screenHeight)
+    {
+        if (fovy != projFovy || aspect != projAspect || zNear != projNear || zFar != projFar)
+            buildClusterBounds(fovy, aspect, zNear, zFar);
+
+        grid.size = glm::ivec4((int) GRID_X, (int) GRID_Y, (int) GRID_Z, 0);
+        grid.params = glm::vec4((float) screenWidth / GRID_X, (float) screenHeight / GRID_Y, sliceScale, sliceBias);
+
+        stagedLights.assign(lights.begin(), lights.end());
+        std::fill(clusterData.begin(), clusterData.end(), 0u);
+        assignments.clear();
+        // room for every light in every cluster, so a moving camera never grows the lists; they only
+        // grow when lights are added
+        if (assignments.capacity() < stagedLights.size() * CLUSTER_COUNT)
+        {
+            assignments.reserve(stagedLights.size() * CLUSTER_COUNT);
+            lightIndices.reserve(stagedLights.size() * CLUSTER_COUNT);
+        }
+
+        float tanY = std::tan(fovy * 0.5f);
+        float tanX = tanY * aspect;
+        for (uint32_t i = 0; i < stagedLights.size(); i++) {
+            PointLight &light = stagedLights[i];
+            light.radius = LightRadius(light);
+            // a light without distance falloff reaches everything, any range past the frustum's extent bins the same
+            float r = std::min(light.radius, 2.0f * zFar);
+            glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+            float depth = -center.z;
+            if (r <= 0.0f || depth + r < zNear || depth - r > zFar)
+                continue;
+
+            // conservative range of clusters covered by the light's view space bounding box
+            float nearDepth = std::max(depth - r, zNear);
+            float farDepth = std::min(depth + r, zFar);
+            int z0 = sliceOf(nearDepth), z1 = sliceOf(farDepth);
+            int x0 = tileOf(std::min((center.x - r) / (nearDepth * tanX), (center.x - r) / (farDepth * tanX)), GRID_X);
+            int x1 = tileOf(std::max((center.x + r) / (nearDepth * tanX), (center.x + r) / (farDepth * tanX)), GRID_X);
+            int y0 = tileOf(std::min((center.y - r) / (nearDepth * tanY), (center.y - r) / (farDepth * tanY)), GRID_Y);
+            int y1 = tileOf(std::max((center.y + r) / (nearDepth * tanY), (center.y + r) / (farDepth * tanY)), GRID_Y);
+
+            for (int z = z0; z <= z1; z++)
+                for (int y = y0; y <= y1; y++)
+                    for (int x = x0; x <= x1; x++) {
+                        uint32_t cluster = (z * GRID_Y + y) * GRID_X + x;
+                        if (!sphereIntersects(clusterBounds[cluster], center, r))
+                            continue;
+                        clusterData[2 * cluster + 1]++;
+                        assignments.push_back(std::make_pair(cluster, i));
+                    }
+        }
+
+        // prefix sum over the counts gives each cluster its range in the index list, then scatter
+        uint32_t offset = 0;
+        for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+            clusterData[2 * cluster] = offset;
+            offset += clusterData[2 * cluster + 1];
+        }
+        lightIndices.resize(assignments.size());
+        cursor.assign(clusterData.begin(), clusterData.end());
+        for (const std::pair<uint32_t, uint32_t> &assignment: assignments)
+            lightIndices[cursor[2 * assignment.first]++] = assignment.second;
+
+        upload(lightBuffer, stagedLights.data(), stagedLights.size() * sizeof(PointLight));
+        upload(clusterBuffer, clusterData.data(), clusterData.size() * sizeof(uint32_t));
+        upload(indexBuffer, lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+    }
+
+    // binds the texture buffers to their units, the units are not touched by anything else
+    void Bind() const
+    {
+        GLState &state = GLState::Get();
+        state.BindTexture(LIGHT_DATA_UNIT, GL_TEXTURE_BUFFER, lightTexture);
+        state.BindTexture(CLUSTER_DATA_UNIT, GL_TEXTURE_BUFFER, clusterTexture);
+        state.BindTexture(LIGHT_INDEX_UNIT, GL_TEXTURE_BUFFER, indexTexture);
+    }
+
+    // grid description for the Lights uniform block
+    const ClusterGrid &Grid() const
+    {
+        return grid;
+    }
+
+    size_t LightCount() const
+    {
+        return stagedLights.size();
+    }
+
+    // total number of (cluster, light) pairs, i.e. the length of the light index list
+    size_t IndexCount() const
+    {
+        return lightIndices.size();
+    }
+
+private:
+    struct ClusterBounds {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    GLuint lightBuffer = 0, lightTexture = 0;
+    GLuint clusterBuffer = 0, clusterTexture = 0;
+    GLuint indexBuffer = 0, indexTexture = 0;
+
+    ClusterGrid grid = {};
+    float projFovy = 0.0f, projAspect = 0.0f, projNear = 0.0f, projFar = 0.0f;
+    float sliceScale = 0.0f, sliceBias = 0.0f;
+    std::vector<ClusterBounds> clusterBounds;
+
+    // per-frame scratch, kept around so binning doesn't allocate once the sizes have settled
+    std::vector<PointLight> stagedLights;
+    std::vector<uint32_t> clusterData = std::vector<uint32_t>(2 * CLUSTER_COUNT);
+    std::vector<uint32_t> cursor;
+    std::vector<std::pair<uint32_t, uint32_t>> assignments;
+    std::vector<uint32_t> lightIndices;
+
+    static void createBuffer(GLuint &buffer, GLuint &texture, GLenum format)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glGenTextures(1, &texture);
+        GLState::Get().BindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // orphans the buffer and refills it, an empty buffer keeps a small allocation so the texture stays valid
+    static void upload(GLuint buffer, const void *data, size_t bytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max(bytes, (size_t) 16), nullptr, GL_STREAM_DRAW);
+        if (bytes)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // view space bounding boxes of all clusters, only change with the projection
+    void buildClusterBounds(float fovy, float aspect, float zNear, float zFar)
+    {
+        projFovy = fovy;
+        projAspect = aspect;
+        projNear = zNear;
+        projFar = zFar;
+        // slice = log(depth) * sliceScale + sliceBias, the shaders use the same mapping
+        sliceScale = GRID_Z / std::log(zFar / zNear);
+        sliceBias = -GRID_Z * std::log(zNear) / std::log(zFar / zNear);
+
+        float tanY = std::tan(fovy * 0.5f);
+        float tanX = tanY * aspect;
+        clusterBounds.resize(CLUSTER_COUNT);
+        for (int z = 0; z < GRID_Z; z++) {
+            float sliceNear = zNear * std::pow(zFar / zNear, (float) z / GRID_Z);
+            float sliceFar = zNear * std::pow(zFar / zNear, (float) (z + 1) / GRID_Z);
+            for (int y = 0; y < GRID_Y; y++) {
+                float ndcY0 = 2.0f * y / GRID_Y - 1.0f, ndcY1 = 2.0f * (y + 1) / GRID_Y - 1.0f;
+                for (int x = 0; x < GRID_X; x++) {
+                    float ndcX0 = 2.0f * x / GRID_X - 1.0f, ndcX1 = 2.0f * (x + 1) / GRID_X - 1.0f;
+                    // the tile's side planes pass through the eye, so the box spans the tile at both slice depths
+                    ClusterBounds &bounds = clusterBounds[(z * GRID_Y + y) * GRID_X + x];
+                    bounds.min = glm::vec3(std::min(ndcX0 * tanX * sliceNear, ndcX0 * tanX * sliceFar),
+                                           std::min(ndcY0 * tanY * sliceNear, ndcY0 * tanY * sliceFar), -sliceFar);
+                    bounds.max = glm::vec3(std::max(ndcX1 * tanX * sliceNear, ndcX1 * tanX * sliceFar),
+                                           std::max(ndcY1 * tanY * sliceNear, ndcY1 * tanY * sliceFar), -sliceNear);
+                }
+            }
+        }
+    }
+
+    int sliceOf(float depth) const
+    {
+        return std::min(std::max((int) std::floor(std::log(depth) * sliceScale + sliceBias), 0), GRID_Z - 1);
+    }
+
+    static int tileOf(float ndc, int tiles)
+    {
+        return std::min(std::max((int) std::floor((ndc * 0.5f + 0.5f) * tiles), 0), tiles - 1);
+    }
+
+    static bool sphereIntersects(const ClusterBounds &bounds, const glm::vec3 &center, float radius)
+    {
+        glm::vec3 closest = glm::max(bounds.min, glm::min(center, bounds.max));
+        glm::vec3 offset = closest - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+};
+
+#endif
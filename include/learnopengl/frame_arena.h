@@ -0,0 +1,186 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that only lives for one frame: allocating bumps an offset into one block and
+// Reset at the start of the next frame frees everything at once. A frame that runs out of the block gets
+// overflow blocks from the heap, and the next Reset replaces them and the block by one block large enough
+// for that whole frame, so once the frames stop growing the heap is not touched.
+class FrameArena
+{
+public:
+    static const size_t DEFAULT_CAPACITY = 1 << 20;
+
+    // the arena of the render loop, created on first use on the GL thread. It is never destroyed.
+    static FrameArena &Get()
+    {
+        static FrameArena *arena = new FrameArena(DEFAULT_CAPACITY);
+        return *arena;
+    }
+
+    explicit FrameArena(size_t capacity)
+            : capacity(capacity), block(static_cast<char*>(::operator new(capacity))) {}
+
+    ~FrameArena()
+    {
+        releaseOverflow();
+        ::operator delete(block);
+    }
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // bytes of memory aligned to alignment, which is at most that of std::max_align_t; valid until Reset
+    void *Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes <= capacity)
+        {
+            used = offset + bytes;
+            return block + offset;
+        }
+        overflowBytes += bytes;
+        overflow.push_back(static_cast<char*>(::operator new(bytes)));
+        return overflow.back();
+    }
+
+    // uninitialized room for count objects of T, which is never destroyed
+    template<typename T>
+    T *Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "frame arena objects are never destroyed");
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // frees everything allocated since the last Reset; everything from before it is invalid afterwards
+    void Reset()
+    {
+        if (!overflow.empty())
+        {
+            size_t needed = used + overflowBytes;
+            releaseOverflow();
+            ::operator delete(block);
+            capacity = std::max(2 * capacity, needed);
+            block = static_cast<char*>(::operator new(capacity));
+        }
+        lastFrameBytes = used + overflowBytes;
+        used = 0;
+        overflowBytes = 0;
+        generation++;
+    }
+
+    // counts the Resets, arrays compare it to tell if their storage is still valid
+    uint64_t Generation() const
+    {
+        return generation;
+    }
+
+    // bytes the frame before the last Reset allocated
+    size_t LastFrameBytes() const
+    {
+        return lastFrameBytes;
+    }
+
+    size_t Capacity() const
+    {
+        return capacity;
+    }
+
+private:
+    size_t capacity;
+    char *block;
+    size_t used = 0;
+    std::vector<char*> overflow;
+    size_t overflowBytes = 0;
+    size_t lastFrameBytes = 0;
+    uint64_t generation = 0;
+
+    void releaseOverflow()
+    {
+        for (char *memory: overflow)
+            ::operator delete(memory);
+        overflow.clear();
+    }
+};
+
+// Growable array of per-frame data in a FrameArena, for lists rebuilt every frame. Growing copies into a
+// new arena allocation and leaves the old one to the next Reset. The contents do not survive the Reset:
+// an array used again in a later frame starts out empty.
+template<typename T>
+class FrameArray
+{
+public:
+    static_assert(std::is_trivially_destructible<T>::value, "frame arena objects are never destroyed");
+
+    explicit FrameArray(FrameArena &arena = FrameArena::Get()) : arena(&arena) {}
+
+    // empties the array, keeping its storage within the same frame
+    void clear()
+    {
+        count = 0;
+        dropStaleStorage();
+    }
+
+    void push_back(const T &item)
+    {
+        dropStaleStorage();
+        if (count == capacity)
+            grow(std::max<size_t>(2 * capacity, 16));
+        new (items + count) T(item);
+        count++;
+    }
+
+    size_t size() const
+    {
+        return arena->Generation() == generation ? count : 0;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    T *data() { return items; }
+    const T *data() const { return items; }
+    T *begin() { return items; }
+    T *end() { return items + size(); }
+    const T *begin() const { return items; }
+    const T *end() const { return items + size(); }
+    T &operator[](size_t i) { return items[i]; }
+    const T &operator[](size_t i) const { return items[i]; }
+
+private:
+    FrameArena *arena;
+    T *items = nullptr;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint64_t generation = 0;
+
+    // forgets storage allocated in an earlier frame
+    void dropStaleStorage()
+    {
+        if (generation == arena->Generation())
+            return;
+        items = nullptr;
+        count = 0;
+        capacity = 0;
+        generation = arena->Generation();
+    }
+
+    void grow(size_t newCapacity)
+    {
+        T *grown = arena->Allocate<T>(newCapacity);
+        for (size_t i = 0; i < count; i++)
+            new (grown + i) T(items[i]);
+        items = grown;
+        capacity = newCapacity;
+    }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+
+#include <iostream>
+
+// Geometry buffer of the deferred renderer:
+//   gAlbedo    RGBA8              diffuse color
+//   gNormal    RGBA16F            world space normal
+//   gSpecular  RGBA8              specular color, shininess / 256 in alpha
+//   gDepth     DEPTH24_STENCIL8   hardware depth, world positions are reconstructed from it
+// The depth format matches the usual default framebuffer so it can be blitted over for the forward
+// passes (light gizmo, skybox) that run after the lighting pass.
+class GBuffer
+{
+public:
+    // texture units the lighting pass reads the attachments from
+    static const int ALBEDO_UNIT = 0;
+    static const int NORMAL_UNIT = 1;
+    static const int SPECULAR_UNIT = 2;
+    static const int DEPTH_UNIT = 3;
+
+    unsigned int FBO = 0;
+    int Width = 0;
+    int Height = 0;
+
+    GBuffer()
+    {
+        // attribute-less VAO for the fullscreen triangle, the vertex shader builds it from gl_VertexID
+        glGenVertexArrays(1, &fullscreenVAO);
+    }
+
+    ~GBuffer()
+    {
+        release();
+        GLState::Get().DeleteVertexArray(fullscreenVAO);
+    }
+
+    GBuffer(const GBuffer &) = delete;
+    GBuffer &operator=(const GBuffer &) = delete;
+
+    // (re)creates the attachments when the framebuffer size changes
+    void Resize(int width, int height)
+    {
+        if (FBO != 0 && width == Width && height == Height)
+            return;
+        release();
+        Width = width;
+        Height = height;
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        albedoTexture = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        normalTexture = createTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        specularTexture = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        depthTexture = createTexture(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, specularTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+        unsigned int attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::GBUFFER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // points the sampler uniforms of the lighting shader at the attachment units, call once after linking
+    void SetupShader(Shader &shader) const
+    {
+        shader.use();
+        shader.setInt("gAlbedo", ALBEDO_UNIT);
+        shader.setInt("gNormal", NORMAL_UNIT);
+        shader.setInt("gSpecular", SPECULAR_UNIT);
+        shader.setInt("gDepth", DEPTH_UNIT);
+    }
+
+    void BindTextures() const
+    {
+        GLState &state = GLState::Get();
+        state.BindTexture(ALBEDO_UNIT, GL_TEXTURE_2D, albedoTexture);
+        state.BindTexture(NORMAL_UNIT, GL_TEXTURE_2D, normalTexture);
+        state.BindTexture(SPECULAR_UNIT, GL_TEXTURE_2D, specularTexture);
+        state.BindTexture(DEPTH_UNIT, GL_TEXTURE_2D, depthTexture);
+    }
+
+    void DrawFullscreenTriangle() const
+    {
+        GLState::Get().BindVertexArray(fullscreenVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // copies the scene depth into framebuffer (0 for the default one) and leaves it bound, so later
+    // forward passes are depth tested against it
+    void BlitDepthTo(GLuint framebuffer) const
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+private:
+    unsigned int albedoTexture = 0;
+    unsigned int normalTexture = 0;
+    unsigned int specularTexture = 0;
+    unsigned int depthTexture = 0;
+    unsigned int fullscreenVAO = 0;
+
+    unsigned int createTexture(GLint internalFormat, GLenum format, GLenum type) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, Width, Height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    void release()
+    {
+        if (FBO == 0)
+            return;
+        unsigned int textures[4] = {albedoTexture, normalTexture, specularTexture, depthTexture};
+        GLState::Get().DeleteTextures(4, textures);
+        glDeleteFramebuffers(1, &FBO);
+        FBO = 0;
+    }
+};
+
+#endif
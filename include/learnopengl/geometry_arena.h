@@ -0,0 +1,184 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/vertex_packing.h>
+
+#include <cstddef>
+
+// One vertex buffer, one index buffer and one VAO shared by every mesh of a vertex layout. Meshes copy
+// their data in with AllocateVertices/AllocateIndices and only keep the returned offsets, then draw with
+// base vertex draws, so drawing the scene switches between two VAOs instead of one per mesh. 16 and
+// 32-bit indices share the index buffer. Allocation is a bump pointer, meshes live as long as the
+// program; a full buffer is replaced by one twice the size and the contents copied over on the GPU.
+class GeometryArena
+{
+public:
+    enum Layout {
+        FLOAT_VERTICES,  // Vertex
+        PACKED_VERTICES  // PackedVertex
+    };
+
+    // the arena of a layout, created on first use on the GL thread. It is never destroyed, it lives as
+    // long as the GL context.
+    static GeometryArena &ForLayout(Layout layout)
+    {
+        static GeometryArena *arenas[2] = {};
+        if (!arenas[layout])
+            arenas[layout] = new GeometryArena(layout);
+        return *arenas[layout];
+    }
+
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    unsigned int VAO() const
+    {
+        return vao;
+    }
+
+    // copies count vertices of the arena's layout in and returns the index of the first one
+    GLint AllocateVertices(const void *data, size_t count)
+    {
+        size_t bytes = count * stride;
+        reserve(vertexBuffer, vertexCapacity, vertexUsed + bytes, GL_ARRAY_BUFFER);
+        GLint first = vertexUsed / stride;
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, vertexUsed, bytes, data);
+        vertexUsed += bytes;
+        return first;
+    }
+
+    // copies bytes of indices in and returns their byte offset, aligned for 32-bit indices; leaves the VAO
+    // bound, the index buffer binding is part of it
+    size_t AllocateIndices(const void *data, size_t bytes)
+    {
+        size_t offset = (indexUsed + 3) & ~size_t(3);
+        reserve(indexBuffer, indexCapacity, offset + bytes, GL_ELEMENT_ARRAY_BUFFER);
+        GLState::Get().BindVertexArray(vao);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, bytes, data);
+        indexUsed = offset + bytes;
+        return offset;
+    }
+
+    // Sources the per-instance model matrix (attribute locations 5-8, one column each) from instanceVBO,
+    // starting at matrix firstInstance, and leaves the VAO bound. Without base instance draws this is how
+    // a draw picks its range of the buffer; repeating the current setup only binds the VAO.
+    void SetupInstanceAttributes(unsigned int instanceVBO, size_t firstInstance)
+    {
+        GLState::Get().BindVertexArray(vao);
+        if (instanceVBO == attributeInstanceVBO && firstInstance == attributeFirstInstance)
+            return;
+        attributeInstanceVBO = instanceVBO;
+        attributeFirstInstance = firstInstance;
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(5 + column);
+            glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(5 + column, 1);
+        }
+    }
+
+    size_t VertexBytesUsed() const
+    {
+        return vertexUsed;
+    }
+
+    size_t IndexBytesUsed() const
+    {
+        return indexUsed;
+    }
+
+private:
+    static const size_t INITIAL_VERTEX_BYTES = 4 << 20;
+    static const size_t INITIAL_INDEX_BYTES = 1 << 20;
+
+    Layout layout;
+    size_t stride;
+    unsigned int vao = 0;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    size_t vertexCapacity = 0;
+    size_t indexCapacity = 0;
+    size_t vertexUsed = 0;
+    size_t indexUsed = 0;
+    // instance attribute source last set by SetupInstanceAttributes
+    unsigned int attributeInstanceVBO = 0;
+    size_t attributeFirstInstance = 0;
+
+    explicit GeometryArena(Layout layout)
+            : layout(layout), stride(layout == PACKED_VERTICES ? sizeof(PackedVertex) : sizeof(Vertex))
+    {
+        glGenVertexArrays(1, &vao);
+        reserve(vertexBuffer, vertexCapacity, INITIAL_VERTEX_BYTES, GL_ARRAY_BUFFER);
+        reserve(indexBuffer, indexCapacity, INITIAL_INDEX_BYTES, GL_ELEMENT_ARRAY_BUFFER);
+    }
+
+    // grows buffer to hold at least bytes, keeping its contents, and points the VAO (left bound) at the
+    // new buffer
+    void reserve(unsigned int &buffer, size_t &capacity, size_t bytes, GLenum target)
+    {
+        if (bytes <= capacity)
+            return;
+        size_t newCapacity = capacity > 0 ? capacity : bytes;
+        while (newCapacity < bytes)
+            newCapacity *= 2;
+
+        unsigned int newBuffer;
+        glGenBuffers(1, &newBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+        if (buffer != 0)
+        {
+            size_t used = target == GL_ARRAY_BUFFER ? vertexUsed : indexUsed;
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = newBuffer;
+        capacity = newCapacity;
+
+        GLState::Get().BindVertexArray(vao);
+        if (target == GL_ELEMENT_ARRAY_BUFFER)
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            if (layout == PACKED_VERTICES)
+                VertexQuantization::SetupPackedAttributes();
+            else
+                setupFloatAttributes();
+        }
+    }
+
+    // attribute pointers of a VAO sourcing Vertex from the bound GL_ARRAY_BUFFER
+    static void setupFloatAttributes()
+    {
+        // A great thing about structs is that their memory layout is sequential for all its items.
+        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+        // again translates to 3/2 floats which translates to a byte array.
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
+};
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// calls GLState passed on to the driver and calls it dropped because they would not change anything,
+// since the last ResetCounters
+struct GLStateCounters {
+    unsigned int issued = 0;
+    unsigned int skipped = 0;
+};
+
+// Shadow copy of the GL state the renderer switches most: the program, the VAO, the active texture unit,
+// the textures bound to each unit and the depth test, face culling and blending switches with the depth
+// function and mask. Setting what is already set is skipped. The copy only stays right while every
+// change of that state goes through here, so code that changes it behind GLState's back (the ImGui
+// backend) is followed by Invalidate, and textures and VAOs are deleted through it.
+class GLState
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    // the state of the current context, created on first use on the GL thread. It is never destroyed.
+    static GLState &Get()
+    {
+        static GLState *state = new GLState();
+        return *state;
+    }
+
+    GLState(const GLState &) = delete;
+    GLState &operator=(const GLState &) = delete;
+
+    void UseProgram(GLuint program)
+    {
+        if (!changed(currentProgram, program))
+            return;
+        glUseProgram(program);
+    }
+
+    void BindVertexArray(GLuint vao)
+    {
+        if (!changed(currentVertexArray, vao))
+            return;
+        glBindVertexArray(vao);
+    }
+
+    void ActiveTexture(int unit)
+    {
+        if (!changed(activeUnit, (GLuint) unit))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // binds texture to target on unit, switching the active unit only when the bind is needed.
+    // Targets other than 2D, 2D array, cube map and buffer textures are always bound.
+    void BindTexture(int unit, GLenum target, GLuint texture)
+    {
+        int slot = targetSlot(target);
+        if (slot < 0 || unit >= MAX_TEXTURE_UNITS)
+        {
+            ActiveTexture(unit);
+            counters.issued++;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (textures[unit][slot] == texture)
+        {
+            counters.skipped++;
+            return;
+        }
+        ActiveTexture(unit);
+        counters.issued++;
+        glBindTexture(target, texture);
+        textures[unit][slot] = texture;
+    }
+
+    // binds texture on whichever unit is active, for creating and uploading textures
+    void BindTexture(GLenum target, GLuint texture)
+    {
+        if (activeUnit == UNKNOWN)
+            ActiveTexture(0);
+        BindTexture(activeUnit, target, texture);
+    }
+
+    // GL_DEPTH_TEST, GL_CULL_FACE or GL_BLEND; other capabilities are always set
+    void SetEnabled(GLenum capability, bool enabled)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot >= 0 && !changed(capabilities[slot], enabled ? 1u : 0u))
+            return;
+        if (slot < 0)
+            counters.issued++;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (!changed(depthFunc, func))
+            return;
+        glDepthFunc(func);
+    }
+
+    void DepthMask(GLboolean mask)
+    {
+        if (!changed(depthMask, (GLuint) mask))
+            return;
+        glDepthMask(mask);
+    }
+
+    // deletes textures and forgets where they were bound, GL unbinds them and may hand the names out again
+    void DeleteTextures(GLsizei count, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+                for (int slot = 0; slot < TEXTURE_TARGETS; slot++)
+                    if (textures[unit][slot] == names[i])
+                        textures[unit][slot] = 0;
+        glDeleteTextures(count, names);
+    }
+
+    void DeleteVertexArray(GLuint vao)
+    {
+        if (currentVertexArray == vao)
+            currentVertexArray = 0;
+        glDeleteVertexArrays(1, &vao);
+    }
+
+    // forgets everything, the next call of each kind is issued
+    void Invalidate()
+    {
+        currentProgram = UNKNOWN;
+        currentVertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            for (int slot = 0; slot < TEXTURE_TARGETS; slot++)
+                textures[unit][slot] = UNKNOWN;
+        for (int slot = 0; slot < CAPABILITIES; slot++)
+            capabilities[slot] = UNKNOWN;
+        depthFunc = UNKNOWN;
+        depthMask = UNKNOWN;
+    }
+
+    const GLStateCounters &Counters() const
+    {
+        return counters;
+    }
+
+    void ResetCounters()
+    {
+        counters = GLStateCounters();
+    }
+
+private:
+    // never a GL name or enum value the renderer sets
+    static const GLuint UNKNOWN = ~0u;
+    static const int TEXTURE_TARGETS = 4;
+    static const int CAPABILITIES = 3;
+
+    GLuint currentProgram;
+    GLuint currentVertexArray;
+    GLuint activeUnit;
+    GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+    GLuint capabilities[CAPABILITIES];
+    GLuint depthFunc;
+    GLuint depthMask;
+    GLStateCounters counters;
+
+    GLState()
+    {
+        Invalidate();
+    }
+
+    // records value and counts the call, false if it was already set
+    bool changed(GLuint &current, GLuint value)
+    {
+        if (current == value)
+        {
+            counters.skipped++;
+            return false;
+        }
+        current = value;
+        counters.issued++;
+        return true;
+    }
+
+    static int targetSlot(GLenum target)
+    {
+        switch (target)
+        {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_2D_ARRAY: return 1;
+            case GL_TEXTURE_CUBE_MAP: return 2;
+            case GL_TEXTURE_BUFFER: return 3;
+            default: return -1;
+        }
+    }
+
+    static int capabilitySlot(GLenum capability)
+    {
+        switch (capability)
+        {
+            case GL_DEPTH_TEST: return 0;
+            case GL_CULL_FACE: return 1;
+            case GL_BLEND: return 2;
+            default: return -1;
+        }
+    }
+};
+
+#endif
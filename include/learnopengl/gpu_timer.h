@@ -0,0 +1,268 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// one section of a frame as measured by the Profiler, in milliseconds; starts are relative to the start
+// of the frame on the respective clock
+struct ProfileScopeResult {
+    const char *name;
+    // nesting level, 0 for scopes directly in the frame
+    int depth;
+    // index of the scope's history in Profiler::Tracks
+    int track;
+    float cpuStart, cpuMs;
+    float gpuStart, gpuMs;
+};
+
+// Nested CPU and GPU timing of named sections of the frame. The GPU side writes GL_TIMESTAMP queries at
+// both ends of every scope, which unlike GL_TIME_ELAPSED may nest, and one at each end of the frame.
+// The queries are double buffered: a frame's are read back BUFFERED_FRAMES frames later when its slot
+// comes around again, and a frame whose results are not available by then is dropped instead of waited
+// for. Scope names are compared by content and must outlive the profiler, string literals in practice.
+class Profiler
+{
+public:
+    static const int BUFFERED_FRAMES = 2;
+    static const int MAX_SCOPES = 64;
+    static const int HISTORY = 120;
+
+    // past times of the scopes of one name, summed per frame and 0 in frames without it; the ring is
+    // written at HistoryOffset. Track 0 is the whole frame.
+    struct Track {
+        const char *name;
+        float cpuMs[HISTORY];
+        float gpuMs[HISTORY];
+    };
+
+    // the profiler, created on first use on the GL thread. It is never destroyed, it lives as long as
+    // the GL context.
+    static Profiler &Get()
+    {
+        static Profiler *profiler = new Profiler();
+        return *profiler;
+    }
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    // collects the frame last recorded in the current slot and starts recording a new one
+    void BeginFrame()
+    {
+        Frame &frame = frames[current];
+        if (frame.queries[0] == 0)
+            glGenQueries(QUERY_COUNT, frame.queries);
+        if (frame.pending)
+            collect(frame, false);
+        frame.scopes.clear();
+        frame.stack.clear();
+        frame.cpuStart = now();
+        glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+        recording = true;
+    }
+
+    // closes scopes left open and the frame
+    void EndFrame()
+    {
+        if (!recording)
+            return;
+        Frame &frame = frames[current];
+        while (!frame.stack.empty())
+            End();
+        frame.cpuEnd = now();
+        glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+        frame.pending = true;
+        recording = false;
+        current = (current + 1) % BUFFERED_FRAMES;
+    }
+
+    // opens a scope nested in the open ones; outside a frame or past MAX_SCOPES it is not recorded
+    void Begin(const char *name)
+    {
+        Frame &frame = frames[current];
+        if (!recording || frame.scopes.size() == (size_t) MAX_SCOPES)
+        {
+            frame.stack.push_back(-1);
+            return;
+        }
+        frame.stack.push_back(frame.scopes.size());
+        frame.scopes.push_back(ScopeRecord{name, (int) frame.stack.size() - 1, now(), 0.0});
+        glQueryCounter(frame.queries[2 * frame.scopes.size()], GL_TIMESTAMP);
+    }
+
+    // waits for every recorded frame and collects it, oldest first, so Results is the last ended frame.
+    // Stalls the pipeline; for offline runs that want every frame.
+    void Flush()
+    {
+        for (int i = 0; i < BUFFERED_FRAMES; i++)
+        {
+            Frame &frame = frames[(current + i) % BUFFERED_FRAMES];
+            if (frame.pending)
+                collect(frame, true);
+        }
+    }
+
+    // closes the innermost open scope
+    void End()
+    {
+        Frame &frame = frames[current];
+        if (frame.stack.empty())
+            return;
+        int scope = frame.stack.back();
+        frame.stack.pop_back();
+        if (scope < 0)
+            return;
+        frame.scopes[scope].cpuEnd = now();
+        glQueryCounter(frame.queries[2 * scope + 3], GL_TIMESTAMP);
+    }
+
+    // scopes of the most recent collected frame, in the order they were opened
+    const std::vector<ProfileScopeResult> &Results() const
+    {
+        return results;
+    }
+
+    float FrameCpuMs() const
+    {
+        return frameCpuMs;
+    }
+
+    float FrameGpuMs() const
+    {
+        return frameGpuMs;
+    }
+
+    const std::vector<Track> &Tracks() const
+    {
+        return tracks;
+    }
+
+    // ring index the next collected frame is written to, the oldest entry of every track
+    int HistoryOffset() const
+    {
+        return historyOffset;
+    }
+
+    // frames whose queries were not finished when their slot was reused
+    unsigned int DroppedFrames() const
+    {
+        return droppedFrames;
+    }
+
+private:
+    // frame start and end, then start and end of each scope
+    static const int QUERY_COUNT = 2 + 2 * MAX_SCOPES;
+
+    struct ScopeRecord {
+        const char *name;
+        int depth;
+        double cpuBegin, cpuEnd;
+    };
+
+    struct Frame {
+        GLuint queries[QUERY_COUNT] = {};
+        std::vector<ScopeRecord> scopes;
+        // indices of the open scopes, -1 for ones that are not recorded
+        std::vector<int> stack;
+        double cpuStart = 0.0, cpuEnd = 0.0;
+        bool pending = false;
+    };
+
+    Frame frames[BUFFERED_FRAMES];
+    int current = 0;
+    bool recording = false;
+    std::vector<ProfileScopeResult> results;
+    std::vector<Track> tracks;
+    int historyOffset = 0;
+    float frameCpuMs = 0.0f;
+    float frameGpuMs = 0.0f;
+    unsigned int droppedFrames = 0;
+
+    Profiler()
+    {
+        trackOf("Frame");
+    }
+
+    static double now()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int trackOf(const char *name)
+    {
+        for (size_t i = 0; i < tracks.size(); i++)
+            if (tracks[i].name == name || std::strcmp(tracks[i].name, name) == 0)
+                return i;
+        tracks.push_back(Track{name, {}, {}});
+        return tracks.size() - 1;
+    }
+
+    // turns the timestamps of a finished frame into results and appends it to the history; unless wait
+    // is set, a frame that is not finished yet is dropped
+    void collect(Frame &frame, bool wait)
+    {
+        frame.pending = false;
+        // the end of the frame is written last, once it is available the rest is as well
+        GLint available = 0;
+        if (!wait)
+            glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!wait && !available)
+        {
+            droppedFrames++;
+            return;
+        }
+        GLuint64 timestamps[QUERY_COUNT];
+        size_t queryCount = 2 + 2 * frame.scopes.size();
+        for (size_t i = 0; i < queryCount; i++)
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+        auto gpuMs = [&](size_t from, size_t to) {
+            return timestamps[to] > timestamps[from] ? (timestamps[to] - timestamps[from]) / 1.0e6f : 0.0f;
+        };
+        frameCpuMs = (float) (frame.cpuEnd - frame.cpuStart);
+        frameGpuMs = gpuMs(0, 1);
+        results.clear();
+        for (size_t i = 0; i < frame.scopes.size(); i++)
+        {
+            const ScopeRecord &scope = frame.scopes[i];
+            results.push_back(ProfileScopeResult{scope.name, scope.depth, trackOf(scope.name),
+                                                 (float) (scope.cpuBegin - frame.cpuStart), (float) (scope.cpuEnd - scope.cpuBegin),
+                                                 gpuMs(0, 2 + 2 * i), gpuMs(2 + 2 * i, 3 + 2 * i)});
+        }
+
+        for (Track &track: tracks)
+            track.cpuMs[historyOffset] = track.gpuMs[historyOffset] = 0.0f;
+        tracks[0].cpuMs[historyOffset] = frameCpuMs;
+        tracks[0].gpuMs[historyOffset] = frameGpuMs;
+        for (const ProfileScopeResult &result: results)
+        {
+            tracks[result.track].cpuMs[historyOffset] += result.cpuMs;
+            tracks[result.track].gpuMs[historyOffset] += result.gpuMs;
+        }
+        historyOffset = (historyOffset + 1) % HISTORY;
+    }
+};
+
+// profiles the enclosing scope
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name)
+    {
+        Profiler::Get().Begin(name);
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::Get().End();
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#endif
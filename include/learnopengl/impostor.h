@@ -0,0 +1,247 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Billboard stand-in for a model seen from far away. Bake renders the model once, orthographically,
+// from framesPerSide x framesPerSide directions over the upper hemisphere into an atlas; the directions
+// are laid out hemi-octahedrally so neighbouring cells are neighbouring views. The atlas holds
+//   albedo        RGBA8   diffuse color, coverage in alpha
+//   normalDepth   RGBA8   model space normal * 0.5 + 0.5, depth along the view direction in alpha
+// and DrawInstanced draws one camera-facing quad per instance, textured with the frame closest to the
+// direction it is seen from (impostor.vs). The depth lets the lighting put each fragment back on the
+// baked surface instead of the billboard plane.
+class Impostor
+{
+public:
+    // texture units the atlases are bound to when drawing
+    static const int ALBEDO_UNIT = 0;
+    static const int NORMAL_DEPTH_UNIT = 1;
+
+    explicit Impostor(int framesPerSide = 8, int frameSize = 128)
+            : framesPerSide(framesPerSide), frameSize(frameSize)
+    {
+        // quad corners in [-1, 1], impostor.vs places them in the frame plane
+        float corners[] = {
+            -1.0f, -1.0f,   1.0f, -1.0f,   -1.0f, 1.0f,   1.0f, 1.0f
+        };
+        glGenVertexArrays(1, &quadVAO);
+        glGenBuffers(1, &quadVBO);
+        glGenBuffers(1, &instanceVBO);
+        GLState::Get().BindVertexArray(quadVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        // per-instance model matrix at attribute locations 5-8, like Mesh::SetupInstanceAttributes
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(5 + column);
+            glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(5 + column, 1);
+        }
+    }
+
+    ~Impostor()
+    {
+        GLState::Get().DeleteTextures(1, &albedoTexture);
+        GLState::Get().DeleteTextures(1, &normalDepthTexture);
+        GLState::Get().DeleteVertexArray(quadVAO);
+        glDeleteBuffers(1, &quadVBO);
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+    Impostor(const Impostor &) = delete;
+    Impostor &operator=(const Impostor &) = delete;
+
+    bool IsBaked() const
+    {
+        return albedoTexture != 0;
+    }
+
+    // Renders the atlas of a loaded model with bakeShader (impostor_bake.vs/fs). Changes the framebuffer,
+    // viewport and clear color and restores them afterwards.
+    void Bake(Model &model, Shader &bakeShader)
+    {
+        if (!model.IsReady() || model.Sphere.IsEmpty() || IsBaked())
+            return;
+        sphere = model.Sphere;
+        float radius = std::max(sphere.radius, 1e-4f);
+        int size = framesPerSide * frameSize;
+
+        GLint previousFramebuffer = 0;
+        GLint previousViewport[4];
+        GLfloat previousClearColor[4];
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+        unsigned int fbo, depthRenderbuffer;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        albedoTexture = createAtlas(size);
+        normalDepthTexture = createAtlas(size);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalDepthTexture, 0);
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::IMPOSTOR:: Framebuffer is not complete!" << std::endl;
+
+        glViewport(0, 0, size, size);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // foliage is usually single sided geometry meant to be seen from both sides
+        GLState::Get().SetEnabled(GL_CULL_FACE, false);
+
+        bakeShader.use();
+        bakeShader.setVec4("impostorSphere", glm::vec4(sphere.center, radius));
+        for (int y = 0; y < framesPerSide; y++)
+        {
+            for (int x = 0; x < framesPerSide; x++)
+            {
+                glm::vec3 direction = FrameDirection(x, y);
+                glm::vec3 right, up;
+                frameBasis(direction, right, up);
+                glm::mat4 view = glm::lookAt(sphere.center + direction * 2.0f * radius, sphere.center, up);
+                glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+                bakeShader.setMat4("viewProjection", projection * view);
+                bakeShader.setVec3("frameDirection", direction);
+                glViewport(x * frameSize, y * frameSize, frameSize, frameSize);
+                model.Draw(bakeShader);
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+        GLState::Get().SetEnabled(GL_CULL_FACE, cullFace);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteFramebuffers(1, &fbo);
+
+        // a few mip levels keep distant impostors from shimmering without bleeding across whole cells
+        for (unsigned int texture: { albedoTexture, normalDepthTexture })
+        {
+            GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 3);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+
+    // view direction of atlas cell (x, y), model space, pointing from the model towards the viewer
+    glm::vec3 FrameDirection(int x, int y) const
+    {
+        glm::vec2 p = (glm::vec2(x, y) + 0.5f) / (float)framesPerSide * 2.0f - 1.0f;
+        glm::vec2 t = glm::vec2(p.x + p.y, p.x - p.y) * 0.5f;
+        return glm::normalize(glm::vec3(t.x, 1.0f - std::abs(t.x) - std::abs(t.y), t.y));
+    }
+
+    // assigns the atlas texture units of a shader drawing impostors
+    static void SetupShader(Shader &shader)
+    {
+        shader.use();
+        shader.setInt("impostorAlbedo", ALBEDO_UNIT);
+        shader.setInt("impostorNormalDepth", NORMAL_DEPTH_UNIT);
+    }
+
+    // sizes the scratch list of DrawInstanced for up to count instances
+    void ReserveInstances(size_t count)
+    {
+        visibleInstances.reserve(count);
+    }
+
+    // Draws one billboard per model matrix with shader (impostor.vs), skipping instances whose
+    // bounding sphere is outside the frustum when one is given.
+    void DrawInstanced(Shader &shader, const std::vector<glm::mat4> &modelMatrices, const Frustum *frustum, CullStats &stats)
+    {
+        if (!IsBaked() || modelMatrices.empty())
+            return;
+        visibleInstances.clear();
+        for (const glm::mat4 &modelMatrix: modelMatrices)
+        {
+            if (frustum && !frustum->Intersects(sphere.Transformed(modelMatrix)))
+                stats.objectsCulled++;
+            else
+                visibleInstances.push_back(modelMatrix);
+        }
+        if (visibleInstances.empty())
+            return;
+        stats.objectsDrawn += visibleInstances.size();
+        stats.impostorsDrawn += visibleInstances.size();
+        stats.trianglesDrawn += 2 * visibleInstances.size();
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (visibleInstances.size() > instanceCapacity)
+        {
+            instanceCapacity = visibleInstances.size();
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), visibleInstances.data(), GL_STREAM_DRAW);
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, visibleInstances.size() * sizeof(glm::mat4), visibleInstances.data());
+        }
+
+        shader.setVec4("impostorSphere", glm::vec4(sphere.center, sphere.radius));
+        shader.setInt("impostorFrames", framesPerSide);
+        GLState &state = GLState::Get();
+        state.BindTexture(ALBEDO_UNIT, GL_TEXTURE_2D, albedoTexture);
+        state.BindTexture(NORMAL_DEPTH_UNIT, GL_TEXTURE_2D, normalDepthTexture);
+        state.BindVertexArray(quadVAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, visibleInstances.size());
+    }
+
+private:
+    int framesPerSide;
+    int frameSize;
+    // model space bounding sphere the frames were rendered around
+    BoundingSphere sphere;
+    unsigned int albedoTexture = 0;
+    unsigned int normalDepthTexture = 0;
+
+    unsigned int quadVAO = 0;
+    unsigned int quadVBO = 0;
+    unsigned int instanceVBO = 0;
+    size_t instanceCapacity = 0;
+    // scratch list of the instances that passed culling
+    std::vector<glm::mat4> visibleInstances;
+
+    // frame plane axes, must match impostor.vs
+    static void frameBasis(const glm::vec3 &direction, glm::vec3 &right, glm::vec3 &up)
+    {
+        right = std::abs(direction.y) > 0.999f ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                               : glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), direction));
+        up = glm::cross(direction, right);
+    }
+
+    static unsigned int createAtlas(int size)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+};
+
+#endif
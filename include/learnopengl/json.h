@@ -0,0 +1,284 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON to read description files: a parsed document is a tree of values. Numbers are
+// doubles, \u escapes outside ASCII become '?'. Looking up a missing key or index gives a null value,
+// so optional fields are read with a default.
+class JsonValue
+{
+public:
+    enum Type { NULL_VALUE, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+    // parses a whole document; on failure returns false with a message naming the line in error
+    static bool Parse(const std::string &text, JsonValue &value, std::string &error)
+    {
+        Parser parser{text.c_str(), text.c_str() + text.size(), text.c_str(), ""};
+        value = JsonValue();
+        if (parser.Value(value) && (parser.SkipSpace(), parser.at == parser.end))
+            return true;
+        if (parser.error.empty())
+            parser.error = "unexpected characters after the document";
+        error = "line " + std::to_string(parser.Line()) + ": " + parser.error;
+        return false;
+    }
+
+    Type GetType() const { return type; }
+    bool IsNull() const { return type == NULL_VALUE; }
+    bool IsNumber() const { return type == NUMBER; }
+    bool IsString() const { return type == STRING; }
+    bool IsArray() const { return type == ARRAY; }
+    bool IsObject() const { return type == OBJECT; }
+
+    bool Bool(bool otherwise = false) const
+    {
+        return type == BOOL ? boolean : otherwise;
+    }
+
+    double Number(double otherwise = 0.0) const
+    {
+        return type == NUMBER ? number : otherwise;
+    }
+
+    const std::string &String() const
+    {
+        return text;
+    }
+
+    std::string String(const std::string &otherwise) const
+    {
+        return type == STRING ? text : otherwise;
+    }
+
+    // elements of an array or members of an object, 0 for anything else
+    size_t Size() const
+    {
+        return type == ARRAY ? elements.size() : type == OBJECT ? members.size() : 0;
+    }
+
+    const JsonValue &operator[](size_t index) const
+    {
+        return type == ARRAY && index < elements.size() ? elements[index] : Null();
+    }
+
+    // for literal indices, which would be ambiguous between size_t and a null key
+    const JsonValue &operator[](int index) const
+    {
+        return index >= 0 ? (*this)[(size_t) index] : Null();
+    }
+
+    const JsonValue &operator[](const char *key) const
+    {
+        if (type != OBJECT)
+            return Null();
+        for (const std::pair<std::string, JsonValue> &member: members)
+            if (member.first == key)
+                return member.second;
+        return Null();
+    }
+
+    bool Has(const char *key) const
+    {
+        return !(*this)[key].IsNull();
+    }
+
+    // members of an object in document order
+    const std::vector<std::pair<std::string, JsonValue>> &Members() const
+    {
+        return members;
+    }
+
+private:
+    Type type = NULL_VALUE;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    static const JsonValue &Null()
+    {
+        static const JsonValue null;
+        return null;
+    }
+
+    struct Parser {
+        const char *at;
+        const char *end;
+        const char *begin;
+        std::string error;
+
+        int Line() const
+        {
+            int line = 1;
+            for (const char *c = begin; c < at && c < end; c++)
+                line += *c == '\n';
+            return line;
+        }
+
+        bool Fail(const char *message)
+        {
+            if (error.empty())
+                error = message;
+            return false;
+        }
+
+        void SkipSpace()
+        {
+            while (at < end && (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r'))
+                at++;
+        }
+
+        bool Literal(const char *word)
+        {
+            size_t length = std::strlen(word);
+            if ((size_t) (end - at) < length || std::strncmp(at, word, length) != 0)
+                return Fail("unknown literal");
+            at += length;
+            return true;
+        }
+
+        bool Value(JsonValue &value)
+        {
+            SkipSpace();
+            if (at == end)
+                return Fail("unexpected end of the document");
+            switch (*at)
+            {
+                case '{': return Object(value);
+                case '[': return Array(value);
+                case '"': value.type = STRING; return String(value.text);
+                case 't': value.type = BOOL; value.boolean = true; return Literal("true");
+                case 'f': value.type = BOOL; value.boolean = false; return Literal("false");
+                case 'n': value.type = NULL_VALUE; return Literal("null");
+                default: return Number(value);
+            }
+        }
+
+        bool Number(JsonValue &value)
+        {
+            // strtod stops at the end of the number; the document is null-terminated, std::string guarantees it
+            char *numberEnd = nullptr;
+            value.number = std::strtod(at, &numberEnd);
+            if (numberEnd == at)
+                return Fail("expected a value");
+            value.type = NUMBER;
+            at = numberEnd;
+            return true;
+        }
+
+        bool String(std::string &text)
+        {
+            at++;
+            while (at < end && *at != '"')
+            {
+                char c = *at++;
+                if (c != '\\')
+                {
+                    text += c;
+                    continue;
+                }
+                if (at == end)
+                    break;
+                switch (char escaped = *at++)
+                {
+                    case 'n': text += '\n'; break;
+                    case 't': text += '\t'; break;
+                    case 'r': text += '\r'; break;
+                    case 'b': text += '\b'; break;
+                    case 'f': text += '\f'; break;
+                    case 'u':
+                    {
+                        if (end - at < 4)
+                            return Fail("truncated \\u escape");
+                        unsigned long code = std::strtoul(std::string(at, 4).c_str(), nullptr, 16);
+                        text += code < 0x80 ? (char) code : '?';
+                        at += 4;
+                        break;
+                    }
+                    default: text += escaped; break;
+                }
+            }
+            if (at == end)
+                return Fail("unterminated string");
+            at++;
+            return true;
+        }
+
+        bool Array(JsonValue &value)
+        {
+            value.type = ARRAY;
+            at++;
+            SkipSpace();
+            if (at < end && *at == ']')
+            {
+                at++;
+                return true;
+            }
+            for (;;)
+            {
+                value.elements.emplace_back();
+                if (!Value(value.elements.back()))
+                    return false;
+                SkipSpace();
+                if (at < end && *at == ',')
+                {
+                    at++;
+                    continue;
+                }
+                if (at < end && *at == ']')
+                {
+                    at++;
+                    return true;
+                }
+                return Fail("expected , or ] in an array");
+            }
+        }
+
+        bool Object(JsonValue &value)
+        {
+            value.type = OBJECT;
+            at++;
+            SkipSpace();
+            if (at < end && *at == '}')
+            {
+                at++;
+                return true;
+            }
+            for (;;)
+            {
+                SkipSpace();
+                if (at == end || *at != '"')
+                    return Fail("expected a member name");
+                value.members.emplace_back();
+                if (!String(value.members.back().first))
+                    return false;
+                SkipSpace();
+                if (at == end || *at != ':')
+                    return Fail("expected : after a member name");
+                at++;
+                if (!Value(value.members.back().second))
+                    return false;
+                SkipSpace();
+                if (at < end && *at == ',')
+                {
+                    at++;
+                    continue;
+                }
+                if (at < end && *at == '}')
+                {
+                    at++;
+                    return true;
+                }
+                return Fail("expected , or } in an object");
+            }
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Light sources laid out to match the std140 Lights block declared in the lit shaders, so a LightsBlock
+// can be uploaded to its UniformBuffer as is. Scalars sit in the fourth component of the preceding vec3;
+// the padding members only exist to keep every vec3 on a 16 byte boundary.
+//
+// Point lights are not part of the block, they are culled per cluster and read from a texture buffer
+// with the same layout, see learnopengl/clustered_lighting.h.
+
+struct PointLight {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    // range used for culling, filled in by ClusteredLighting
+    float radius;
+};
+
+struct DirLight {
+    glm::vec3 direction;
+    float padding0;
+    glm::vec3 ambient;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 specular;
+    float padding3;
+};
+
+struct SpotLight {
+    glm::vec3 position;
+    float cutOff;
+    glm::vec3 direction;
+    float outerCutOff;
+    glm::vec3 ambient;
+    float padding0;
+    glm::vec3 diffuse;
+    float padding1;
+    glm::vec3 specular;
+    float padding2;
+};
+
+// cluster grid dimensions in size.xyz; tile width and height in pixels and the depth slice
+// scale and bias (slice = log(depth) * scale + bias) in params
+struct ClusterGrid {
+    glm::ivec4 size;
+    glm::vec4 params;
+};
+
+// layout (std140) uniform Lights { DirLight dirLight; SpotLight spotLight; ClusterGrid clusters; };
+struct LightsBlock {
+    DirLight dirLight;
+    SpotLight spotLight;
+    ClusterGrid clusters;
+};
+
+static_assert(sizeof(PointLight) == 64, "PointLight does not match the std140 layout");
+static_assert(sizeof(DirLight) == 64, "DirLight does not match the std140 layout");
+static_assert(sizeof(SpotLight) == 80, "SpotLight does not match the std140 layout");
+static_assert(offsetof(LightsBlock, spotLight) == 64 && offsetof(LightsBlock, clusters) == 144,
+              "LightsBlock does not match the std140 Lights block");
+
+#endif
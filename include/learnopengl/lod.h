@@ -0,0 +1,65 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+
+// one level of detail of a mesh: a range of its index buffer, all levels share the vertex buffer.
+// error is the simplification error in model units, 0 for the full detail level.
+struct MeshLod {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    float error;
+};
+
+// level to draw an object with; with cross-fading, fade > 0 blends in level + 1 by that fraction
+struct LodChoice {
+    int level = 0;
+    float fade = 0.0f;
+};
+
+// Picks levels of detail by how large their simplification error appears on screen: an object is drawn
+// with the coarsest level whose error projects to at most maxPixelError pixels at the object's distance.
+// With cross-fading, the next coarser level is dithered in while its error is still within fadeRange
+// (relative) above the limit, so the switch happens gradually instead of as a pop.
+struct LodSelector {
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    // pixels covered by one world unit at distance 1, see FromCamera
+    float pixelScale = 0.0f;
+    float maxPixelError = 1.0f;
+    bool crossFade = false;
+    float fadeRange = 0.5f;
+
+    static LodSelector FromCamera(const glm::vec3 &cameraPosition, const glm::mat4 &projection, int viewportHeight)
+    {
+        LodSelector selector;
+        selector.cameraPosition = cameraPosition;
+        selector.pixelScale = 0.5f * viewportHeight * projection[1][1];
+        return selector;
+    }
+
+    // levelErrors are the model space errors of levelCount levels, errorScale takes them to world space
+    LodChoice Select(const BoundingSphere &worldSphere, const float *levelErrors, int levelCount, float errorScale) const
+    {
+        LodChoice choice;
+        // distance to the nearest point of the sphere, from inside it everything is full detail
+        float distance = glm::length(worldSphere.center - cameraPosition) - worldSphere.radius;
+        if (levelCount <= 1 || pixelScale <= 0.0f || distance <= 0.0f)
+            return choice;
+
+        float pixelsPerError = errorScale * pixelScale / distance;
+        while (choice.level + 1 < levelCount && levelErrors[choice.level + 1] * pixelsPerError <= maxPixelError)
+            choice.level++;
+
+        if (crossFade && choice.level + 1 < levelCount) {
+            float nextError = levelErrors[choice.level + 1] * pixelsPerError;
+            float fadeStart = maxPixelError * (1.0f + fadeRange);
+            if (nextError < fadeStart)
+                choice.fade = (fadeStart - nextError) / (fadeStart - maxPixelError);
+        }
+        return choice;
+    }
+};
+
+#endif
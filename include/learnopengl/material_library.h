@@ -0,0 +1,278 @@
+#ifndef MATERIAL_LIBRARY_H
+#define MATERIAL_LIBRARY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// texture slots of a material, in the order of their texture units and of the columns of materialData
+enum MaterialSlot {
+    DIFFUSE_SLOT,   // material.texture_diffuse1
+    SPECULAR_SLOT,  // material.texture_specular1
+    NORMAL_SLOT,    // material.texture_normal
+    MATERIAL_SLOTS
+};
+
+// a texture as stored by the MaterialLibrary: a layer of one of its texture arrays
+struct TextureLayer {
+    // index of the texture array in the library, not a GL name
+    unsigned int array;
+    unsigned int layer;
+};
+
+struct Texture {
+    TextureLayer id;
+    std::string type;
+    std::string path;
+};
+
+// All material textures live in GL_TEXTURE_2D_ARRAYs, one per texture size, stored as RGBA8. A material
+// is a row of the materialData texture buffer (RGBA32UI) holding the layer of each slot, so a draw only
+// selects its row with the materialIndex uniform. The arrays of a slot are only rebound when a material
+// of a different texture size comes along, and the sampler uniforms point at fixed units set once per
+// shader instead of being looked up by name on every draw.
+// Bindless textures would drop the remaining rebinds, but the GL 3.3 core loader does not expose them.
+class MaterialLibrary
+{
+public:
+    // texture units of the slots and of the material table, below the ones ClusteredLighting uses
+    static const int FIRST_MATERIAL_UNIT = 0;
+    static const int MATERIAL_DATA_UNIT = FIRST_MATERIAL_UNIT + MATERIAL_SLOTS;
+    // array index of a texture that failed to load, its slot falls back to the default
+    static const unsigned int MISSING_ARRAY = ~0u;
+
+    // texture arrays bound by Bind, zero until then. Keep one per pass of draws so that binds of arrays
+    // that are already in place are skipped.
+    struct Bindings {
+        unsigned int arrays[MATERIAL_SLOTS] = {};
+        bool table = false;
+    };
+
+    // the library, created on first use on the GL thread. It is never destroyed, it lives as long as
+    // the GL context.
+    static MaterialLibrary &Get()
+    {
+        static MaterialLibrary *library = new MaterialLibrary();
+        return *library;
+    }
+
+    MaterialLibrary(const MaterialLibrary &) = delete;
+    MaterialLibrary &operator=(const MaterialLibrary &) = delete;
+
+    // points the material sampler uniforms of a shader at the slot units, call once after linking
+    static void SetupShader(Shader &shader)
+    {
+        shader.use();
+        shader.setInt("material.texture_diffuse1", FIRST_MATERIAL_UNIT + DIFFUSE_SLOT);
+        shader.setInt("material.texture_specular1", FIRST_MATERIAL_UNIT + SPECULAR_SLOT);
+        shader.setInt("material.texture_normal", FIRST_MATERIAL_UNIT + NORMAL_SLOT);
+        shader.setInt("materialData", MATERIAL_DATA_UNIT);
+    }
+
+    // copies an image with 1 to 4 8-bit components into a new layer of the array of its size; the
+    // components fill red, green, blue and alpha in order. Other component counts are refused as missing.
+    TextureLayer AddTexture(const unsigned char *pixels, int width, int height, int components)
+    {
+        static const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+        if (components < 1 || components > 4)
+            return TextureLayer{MISSING_ARRAY, 0};
+        unsigned int index = arrayOfSize(width, height);
+        TextureArray &array = arrays[index];
+        if (array.layers == array.capacity)
+            grow(array, array.capacity * 2);
+        GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+        // rows are tightly packed; with the default alignment of 4 a row that is not a multiple of 4
+        // bytes long would be read from the wrong place and shear the whole layer
+        bool packed = width * components % 4 != 0;
+        if (packed)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, array.layers, width, height, 1, formats[components - 1], GL_UNSIGNED_BYTE, pixels);
+        if (packed)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        array.mipmapsDirty = true;
+        return TextureLayer{index, array.layers++};
+    }
+
+    // index of the material sampling the first texture of each slot type ("texture_diffuse", ...), a slot
+    // without one gets a neutral default. Identical materials share an index.
+    unsigned int AddMaterial(const std::vector<Texture> &textures)
+    {
+        static const char *slotTypes[MATERIAL_SLOTS] = {"texture_diffuse", "texture_specular", "texture_normal"};
+        Material material;
+        for (int slot = 0; slot < MATERIAL_SLOTS; slot++)
+        {
+            material.textures[slot] = TextureLayer{DEFAULT_ARRAY, (unsigned int) slot};
+            for (const Texture &texture: textures)
+            {
+                if (texture.type != slotTypes[slot])
+                    continue;
+                if (texture.id.array != MISSING_ARRAY)
+                    material.textures[slot] = texture.id;
+                break;
+            }
+        }
+        for (size_t i = 0; i < materials.size(); i++)
+            if (materials[i] == material)
+                return i;
+
+        materials.push_back(material);
+        std::vector<uint32_t> table;
+        table.reserve(materials.size() * 4);
+        for (const Material &m: materials)
+            for (int column = 0; column < 4; column++)
+                table.push_back(column < MATERIAL_SLOTS ? m.textures[column].layer : 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, tableBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, table.size() * sizeof(uint32_t), table.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        return materials.size() - 1;
+    }
+
+    // binds the arrays of a material and the material table where bindings says they are not bound yet,
+    // and selects the material's row. Binds that bindings misses but GLState knows about are skipped there.
+    void Bind(Shader &shader, unsigned int materialIndex, Bindings &bindings)
+    {
+        const Material &material = materials[materialIndex];
+        for (int slot = 0; slot < MATERIAL_SLOTS; slot++)
+        {
+            TextureArray &array = arrays[material.textures[slot].array];
+            if (bindings.arrays[slot] == array.id && !array.mipmapsDirty)
+                continue;
+            GLState::Get().BindTexture(FIRST_MATERIAL_UNIT + slot, GL_TEXTURE_2D_ARRAY, array.id);
+            // once per batch of added layers instead of once per layer
+            if (array.mipmapsDirty)
+            {
+                GLState::Get().ActiveTexture(FIRST_MATERIAL_UNIT + slot);
+                glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+                array.mipmapsDirty = false;
+            }
+            bindings.arrays[slot] = array.id;
+        }
+        if (!bindings.table)
+        {
+            GLState::Get().BindTexture(MATERIAL_DATA_UNIT, GL_TEXTURE_BUFFER, tableTexture);
+            bindings.table = true;
+        }
+        shader.meshUniforms.materialIndex.set((int) materialIndex);
+    }
+
+    // GPU memory of the texture arrays, mipmaps included
+    size_t TextureBytes() const
+    {
+        size_t bytes = 0;
+        for (const TextureArray &array: arrays)
+            bytes += array.capacity * (size_t) array.width * array.height * 4 * 4 / 3;
+        return bytes;
+    }
+
+    size_t ArrayCount() const
+    {
+        return arrays.size();
+    }
+
+    size_t MaterialCount() const
+    {
+        return materials.size();
+    }
+
+private:
+    // 1x1 array holding the default texture of each slot, in slot order
+    static const unsigned int DEFAULT_ARRAY = 0;
+
+    struct TextureArray {
+        unsigned int id;
+        int width, height;
+        unsigned int layers;
+        unsigned int capacity;
+        bool mipmapsDirty;
+    };
+
+    struct Material {
+        TextureLayer textures[MATERIAL_SLOTS];
+
+        bool operator==(const Material &other) const
+        {
+            for (int slot = 0; slot < MATERIAL_SLOTS; slot++)
+                if (textures[slot].array != other.textures[slot].array || textures[slot].layer != other.textures[slot].layer)
+                    return false;
+            return true;
+        }
+    };
+
+    std::vector<TextureArray> arrays;
+    std::vector<Material> materials;
+    GLuint tableBuffer = 0, tableTexture = 0;
+
+    MaterialLibrary()
+    {
+        glGenBuffers(1, &tableBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, tableBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STATIC_DRAW);
+        glGenTextures(1, &tableTexture);
+        GLState::Get().BindTexture(GL_TEXTURE_BUFFER, tableTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, tableBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // white diffuse, black specular, flat normal
+        const unsigned char defaults[MATERIAL_SLOTS][4] = {
+            {255, 255, 255, 255}, {0, 0, 0, 255}, {128, 128, 255, 255}
+        };
+        for (int slot = 0; slot < MATERIAL_SLOTS; slot++)
+            AddTexture(defaults[slot], 1, 1, 4);
+    }
+
+    unsigned int arrayOfSize(int width, int height)
+    {
+        for (size_t i = 0; i < arrays.size(); i++)
+            if (arrays[i].width == width && arrays[i].height == height)
+                return i;
+        arrays.push_back(TextureArray{0, width, height, 0, 0, false});
+        grow(arrays.back(), 1);
+        return arrays.size() - 1;
+    }
+
+    // reallocates the array with room for capacity layers and copies the layers over on the GPU through a
+    // read framebuffer (glCopyImageSubData is GL 4.3); the mipmaps are regenerated on the next Bind
+    void grow(TextureArray &array, unsigned int capacity)
+    {
+        GLuint id;
+        glGenTextures(1, &id);
+        GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, id);
+        int levels = 1 + (int) std::floor(std::log2((float) std::max(array.width, array.height)));
+        for (int level = 0; level < levels; level++)
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(1, array.width >> level), std::max(1, array.height >> level),
+                         capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        if (array.id != 0)
+        {
+            GLint previousFramebuffer;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+            GLuint framebuffer;
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            for (unsigned int layer = 0; layer < array.layers; layer++)
+            {
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array.id, 0, layer);
+                glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, array.width, array.height);
+            }
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+            glDeleteFramebuffers(1, &framebuffer);
+            GLState::Get().DeleteTextures(1, &array.id);
+            array.mipmapsDirty = true;
+        }
+        array.id = id;
+        array.capacity = capacity;
+    }
+};
+
+#endif
@@ -7,133 +7,305 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/bounds.h>
+#include <learnopengl/lod.h>
+#include <learnopengl/vertex_packing.h>
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/material_library.h>
+
+#include <algorithm>
+#include <cstdint>
 
 #include <string>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-};
-
-
-
-struct Texture {
-    unsigned int id;
-    string type;
-    string path;
-};
-
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // levels of detail as ranges of indices, full detail first
+    vector<MeshLod>      Lods;
 
     unsigned int VAO;
-    std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // bounds of the vertex positions in model space
+    AABB Box;
+    BoundingSphere Sphere;
+    // whether the vertex buffer holds PackedVertex instead of Vertex, decided in setupMesh
+    bool PackedVertices = false;
+    VertexQuantization Quantization;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT storage of the index buffer, decided in setupMesh
+    GLenum IndexType = GL_UNSIGNED_INT;
+    // constructor, without lods the mesh has a single level made of all indices. positionBounds is the box
+    // positions are quantized against, shared by the meshes of a model; the mesh's own box without it.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<MeshLod> lods = vector<MeshLod>(),
+         const AABB *positionBounds = nullptr)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        this->Lods = lods;
+        if (Lods.empty())
+            Lods.push_back(MeshLod{0, (unsigned int) indices.size(), 0.0f});
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(positionBounds);
+        computeBounds();
+        material = MaterialLibrary::Get().AddMaterial(textures);
+    }
+
+    // level of detail clamped to the levels this mesh has
+    const MeshLod &Lod(int level) const
+    {
+        return Lods[std::min<size_t>(level, Lods.size() - 1)];
+    }
+
+    // size of the vertex buffer on the GPU
+    size_t VertexBufferBytes() const
+    {
+        return vertices.size() * (PackedVertices ? sizeof(PackedVertex) : sizeof(Vertex));
+    }
+
+    // size of the index buffer on the GPU
+    size_t IndexBufferBytes() const
+    {
+        return indices.size() * indexSize();
+    }
+
+    // row of the mesh's material in the MaterialLibrary
+    unsigned int MaterialIndex() const
+    {
+        return material;
     }
 
+    // one draw of a level of a mesh; with instanceCount > 0 that many copies, their model matrices read
+    // from instanceVBO starting at matrix firstInstance
+    struct DrawCommand {
+        Mesh *mesh;
+        int lod;
+        GLsizei instanceCount;
+        unsigned int instanceVBO;
+        size_t firstInstance;
+    };
+
+    // what Submit has bound, carried across calls to skip binds that are still in place. Start a new one
+    // (or reset mesh) when the program changes or something else binds VAOs or material textures.
+    struct SubmitState {
+        MaterialLibrary::Bindings materials;
+        unsigned int vao = 0;
+        const Mesh *mesh = nullptr;
+    };
+
     // render the mesh
-    void Draw(Shader &shader)
-    {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+    void Draw(Shader &shader, int lod = 0)
+    {
+        MaterialLibrary::Bindings bindings;
+        MaterialLibrary::Get().Bind(shader, material, bindings);
+        setDequantization(shader);
+
+        // draw mesh
+        GLState::Get().BindVertexArray(VAO);
+        drawRanges(lod, 0);
+    }
+
+    // render instanceCount copies of the mesh in one draw call, per-instance model matrices are read
+    // from the buffer last passed to SetupInstanceAttributes
+    void DrawInstanced(Shader &shader, unsigned int instanceCount, int lod = 0)
+    {
+        MaterialLibrary::Bindings bindings;
+        MaterialLibrary::Get().Bind(shader, material, bindings);
+        setDequantization(shader);
+
+        GLState::Get().BindVertexArray(VAO);
+        drawRanges(lod, instanceCount);
+    }
+
+    // sources the per-instance model matrix (attribute locations 5-8) of every mesh sharing this mesh's
+    // geometry arena from instanceVBO, starting at matrix firstInstance
+    void SetupInstanceAttributes(unsigned int instanceVBO, size_t firstInstance = 0)
+    {
+        arena->SetupInstanceAttributes(instanceVBO, firstInstance);
+    }
+
+    // Draws a list of commands in order with as few state changes as the order allows: the VAO of the
+    // geometry arena is bound when it changes, the material and dequantization are set when the mesh
+    // changes and texture arrays are only rebound for materials of other texture sizes.
+    static void Submit(Shader &shader, const DrawCommand *commands, size_t count)
+    {
+        SubmitState state;
+        Submit(shader, commands, count, state);
+    }
+
+    // Submit continuing from what earlier calls bound
+    static void Submit(Shader &shader, const DrawCommand *commands, size_t count, SubmitState &state)
+    {
+        MaterialLibrary &materials = MaterialLibrary::Get();
+        for (size_t i = 0; i < count; i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            const DrawCommand &command = commands[i];
+            Mesh &mesh = *command.mesh;
+            if (command.instanceCount > 0)
+            {
+                // binds the VAO as well
+                mesh.arena->SetupInstanceAttributes(command.instanceVBO, command.firstInstance);
+                state.vao = mesh.VAO;
+            }
+            else if (state.vao != mesh.VAO)
+            {
+                GLState::Get().BindVertexArray(mesh.VAO);
+                state.vao = mesh.VAO;
+            }
+            if (&mesh != state.mesh)
+            {
+                materials.Bind(shader, mesh.material, state.materials);
+                mesh.setDequantization(shader);
+                state.mesh = &mesh;
+            }
+            mesh.drawRanges(command.lod, command.instanceCount);
         }
+    }
 
+private:
+    // part of a level drawn with one call, its indices are relative to baseVertex
+    struct IndexRange {
+        unsigned int indexOffset;
+        unsigned int indexCount;
+        GLint baseVertex;
+    };
 
+    // a level may be split into at most this many draws to get 16-bit indices, beyond it stays 32-bit
+    static const size_t MAX_SHORT_INDEX_DRAWS = 16;
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    // render data, the buffers are shared with every mesh of the same vertex layout
+    GeometryArena *arena = nullptr;
+    // position of the mesh in the arena's buffers
+    GLint firstVertex = 0;
+    size_t indexByteOffset = 0;
+    // draws of each level of detail
+    vector<vector<IndexRange>> lodRanges;
+    // row of the material table, from the textures
+    unsigned int material = 0;
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // the vertex shaders take positions and texture coordinates through positionScale, positionOffset and
+    // texCoordTransform (scale in xy, offset in zw); identity for the float layout
+    void setDequantization(Shader &shader)
+    {
+        const MeshUniformLocations &uniforms = shader.meshUniforms;
+        Quantization.SetDequantization(uniforms.positionScale, uniforms.positionOffset, uniforms.texCoordTransform);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+    // box around all vertices, and a sphere around the box center reaching the furthest vertex
+    void computeBounds()
+    {
+        for (const Vertex &vertex: vertices)
+            Box.Expand(vertex.Position);
+        if (Box.IsEmpty())
+            return;
+        Sphere.center = Box.Center();
+        float radiusSquared = 0.0f;
+        for (const Vertex &vertex: vertices) {
+            glm::vec3 offset = vertex.Position - Sphere.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        Sphere.radius = std::sqrt(radiusSquared);
+    }
+
+    // issues the draws of a level with the VAO bound, instanced if instanceCount > 0. A level is one draw
+    // unless its 16-bit indices had to be split over several base vertices.
+    void drawRanges(int lod, GLsizei instanceCount) const
+    {
+        for (const IndexRange &range: lodRanges[std::min<size_t>(lod, lodRanges.size() - 1)])
+        {
+            void *offset = (void*)(indexByteOffset + range.indexOffset * indexSize());
+            if (instanceCount > 0)
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, IndexType, offset, instanceCount, firstVertex + range.baseVertex);
+            else
+                glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, IndexType, offset, firstVertex + range.baseVertex);
+        }
+    }
+
+    size_t indexSize() const
+    {
+        return IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    }
+
+    // Splits a level into runs of triangles whose indices all lie within 65536 vertices of each other, in
+    // the order they are stored (vertex fetch optimized meshes reference their vertices about in order).
+    // Returns false if that needs more than MAX_SHORT_INDEX_DRAWS draws.
+    bool splitForShortIndices(const MeshLod &lod, vector<IndexRange> &ranges) const
+    {
+        const unsigned int window = 65535;
+        ranges.clear();
+        unsigned int low = 0, high = 0;
+        for (unsigned int i = lod.indexOffset; i + 3 <= lod.indexOffset + lod.indexCount; i += 3)
+        {
+            unsigned int triangleLow = std::min(indices[i], std::min(indices[i + 1], indices[i + 2]));
+            unsigned int triangleHigh = std::max(indices[i], std::max(indices[i + 1], indices[i + 2]));
+            bool fits = !ranges.empty() && std::max(high, triangleHigh) - std::min(low, triangleLow) <= window;
+            if (!fits)
+            {
+                if (triangleHigh - triangleLow > window || ranges.size() == MAX_SHORT_INDEX_DRAWS)
+                    return false;
+                ranges.push_back(IndexRange{i, 0, 0});
+                low = triangleLow;
+                high = triangleHigh;
+            }
+            low = std::min(low, triangleLow);
+            high = std::max(high, triangleHigh);
+            ranges.back().indexCount += 3;
+            ranges.back().baseVertex = low;
+        }
+        return true;
+    }
+
+    // 16-bit indices whenever every level can be drawn with them, otherwise 32-bit with one draw per level
+    void setupIndices()
+    {
+        lodRanges.assign(Lods.size(), vector<IndexRange>());
+        IndexType = GL_UNSIGNED_SHORT;
+        for (size_t level = 0; level < Lods.size() && IndexType == GL_UNSIGNED_SHORT; level++)
+            if (!splitForShortIndices(Lods[level], lodRanges[level]))
+                IndexType = GL_UNSIGNED_INT;
+
+        if (IndexType == GL_UNSIGNED_SHORT)
+        {
+            vector<uint16_t> shortIndices(indices.size());
+            for (const vector<IndexRange> &ranges: lodRanges)
+                for (const IndexRange &range: ranges)
+                    for (unsigned int i = range.indexOffset; i < range.indexOffset + range.indexCount; i++)
+                        shortIndices[i] = (uint16_t) (indices[i] - range.baseVertex);
+            indexByteOffset = arena->AllocateIndices(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+            return;
+        }
+
+        for (size_t level = 0; level < Lods.size(); level++)
+            lodRanges[level].assign(1, IndexRange{Lods[level].indexOffset, Lods[level].indexCount, 0});
+        indexByteOffset = arena->AllocateIndices(indices.data(), indices.size() * sizeof(unsigned int));
+    }
+
+    // copies the vertices and indices into the geometry arena of their layout
+    void setupMesh(const AABB *positionBounds)
+    {
+        // meshes whose attributes quantize well get the 20 byte layout, the rest keep the float one
+        Quantization = VertexQuantization::Fit(vertices, PackedVertices, positionBounds);
+        arena = &GeometryArena::ForLayout(PackedVertices ? GeometryArena::PACKED_VERTICES : GeometryArena::FLOAT_VERTICES);
+        VAO = arena->VAO();
+        if (PackedVertices)
+        {
+            vector<PackedVertex> packed;
+            packed.reserve(vertices.size());
+            for (const Vertex &vertex: vertices)
+                packed.push_back(Quantization.Pack(vertex));
+            firstVertex = arena->AllocateVertices(packed.data(), packed.size());
+        }
+        else
+        {
+            firstVertex = arena->AllocateVertices(vertices.data(), vertices.size());
+        }
+        setupIndices();
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// texture reference as found in the source material, resolved against the model directory on upload
+struct TextureRef {
+    std::string type;
+    std::string path;
+};
+
+// CPU-side mesh data, either produced by Assimp or read back from the binary mesh cache
+struct MeshData {
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TextureRef>   textures;
+    // levels of detail, ranges of indices
+    std::vector<MeshLod>      lods;
+};
+
+// Binary pre-baked mesh cache stored next to the source model as "<model>.meshcache".
+//
+// Layout (native endianness, all sections 4-byte aligned):
+//   MeshCacheHeader
+//   per mesh: uint32 vertexCount, uint32 indexCount, uint32 textureCount, uint32 lodCount,
+//             textureCount x (uint32 typeLength, type, uint32 pathLength, path), padding,
+//             vertexCount x Vertex, indexCount x uint32, lodCount x MeshLod
+//
+// A cache is only accepted when magic, version, vertex size, source hash and post-process flags all
+// match, otherwise the caller falls back to Assimp and rewrites it. The source hash covers the model file
+// and the material libraries it references, see HashSource; texture images are not part of the cache.
+class MeshCache
+{
+public:
+    static const uint32_t VERSION = 4;
+
+    static std::string CachePath(const std::string &sourcePath)
+    {
+        return sourcePath + ".meshcache";
+    }
+
+    // 64-bit FNV-1a hash of a model file and, for .obj files, of the material libraries its "mtllib"
+    // lines name, so editing the materials or texture assignments invalidates the cache too. A library
+    // that cannot be read contributes only its name, so creating it later changes the hash as well.
+    static bool HashSource(const std::string &path, uint64_t &hash)
+    {
+        MappedFile file;
+        if (!file.open(path))
+            return false;
+        hash = FNV_OFFSET;
+        hashBytes(file.data, file.size, hash);
+        if (path.size() < 4 || strcasecmp(path.c_str() + path.size() - 4, ".obj") != 0)
+            return true;
+
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        const char *text = (const char *) file.data;
+        const char *end = text + file.size;
+        for (const char *line = text; line < end; ) {
+            const char *lineEnd = (const char *) memchr(line, '\n', end - line);
+            if (!lineEnd)
+                lineEnd = end;
+            if (lineEnd - line > 7 && strncmp(line, "mtllib", 6) == 0 && (line[6] == ' ' || line[6] == '\t')) {
+                // one or more library names separated by white space
+                const char *name = line + 6;
+                while (name < lineEnd) {
+                    while (name < lineEnd && isspace((unsigned char) *name))
+                        name++;
+                    const char *nameEnd = name;
+                    while (nameEnd < lineEnd && !isspace((unsigned char) *nameEnd))
+                        nameEnd++;
+                    if (nameEnd > name) {
+                        std::string library(name, nameEnd);
+                        hashBytes(library.data(), library.size(), hash);
+                        MappedFile material;
+                        if (material.open(directory + library))
+                            hashBytes(material.data, material.size, hash);
+                    }
+                    name = nameEnd;
+                }
+            }
+            line = lineEnd + 1;
+        }
+        return true;
+    }
+
+    static bool Load(const std::string &cachePath, uint64_t sourceHash, unsigned int postProcessFlags, std::vector<MeshData> &meshes)
+    {
+        MappedFile file;
+        if (!file.open(cachePath))
+            return false;
+
+        Reader reader{(const char *) file.data, file.size, 0};
+        MeshCacheHeader header;
+        if (!reader.read(&header, sizeof(header)))
+            return false;
+        if (header.magic != MAGIC || header.version != VERSION ||
+            header.vertexSize != sizeof(Vertex) || header.sourceHash != sourceHash ||
+            header.postProcessFlags != postProcessFlags || header.meshCount > reader.remaining() / 16) {
+            return false;
+        }
+
+        std::vector<MeshData> loaded(header.meshCount);
+        for (MeshData &mesh: loaded) {
+            uint32_t vertexCount, indexCount, textureCount, lodCount;
+            if (!reader.read(&vertexCount, sizeof(vertexCount)) || !reader.read(&indexCount, sizeof(indexCount)) ||
+                !reader.read(&textureCount, sizeof(textureCount)) || !reader.read(&lodCount, sizeof(lodCount)))
+                return false;
+
+            mesh.textures.resize(textureCount);
+            for (TextureRef &texture: mesh.textures) {
+                if (!reader.readString(texture.type) || !reader.readString(texture.path))
+                    return false;
+            }
+            reader.align();
+            if ((uint64_t) vertexCount * sizeof(Vertex) + (uint64_t) indexCount * sizeof(unsigned int) +
+                (uint64_t) lodCount * sizeof(MeshLod) > reader.remaining())
+                return false;
+
+            mesh.vertices.resize(vertexCount);
+            mesh.indices.resize(indexCount);
+            mesh.lods.resize(lodCount);
+            if (!reader.read(mesh.vertices.data(), vertexCount * sizeof(Vertex)) ||
+                !reader.read(mesh.indices.data(), indexCount * sizeof(unsigned int)) ||
+                !reader.read(mesh.lods.data(), lodCount * sizeof(MeshLod)))
+                return false;
+            for (const MeshLod &lod: mesh.lods)
+                if ((uint64_t) lod.indexOffset + lod.indexCount > indexCount)
+                    return false;
+        }
+
+        meshes.swap(loaded);
+        return true;
+    }
+
+    static bool Save(const std::string &cachePath, uint64_t sourceHash, unsigned int postProcessFlags, const std::vector<MeshData> &meshes)
+    {
+        // write to a per-thread temporary file first so a concurrent reader never sees a half-written cache
+        std::string tempPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+
+            MeshCacheHeader header;
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.vertexSize = sizeof(Vertex);
+            header.postProcessFlags = postProcessFlags;
+            header.sourceHash = sourceHash;
+            header.meshCount = (uint32_t) meshes.size();
+            header.reserved = 0;
+            out.write((const char *) &header, sizeof(header));
+
+            for (const MeshData &mesh: meshes) {
+                uint32_t counts[4] = {(uint32_t) mesh.vertices.size(), (uint32_t) mesh.indices.size(),
+                                      (uint32_t) mesh.textures.size(), (uint32_t) mesh.lods.size()};
+                out.write((const char *) counts, sizeof(counts));
+                size_t written = sizeof(counts);
+                for (const TextureRef &texture: mesh.textures) {
+                    written += writeString(out, texture.type);
+                    written += writeString(out, texture.path);
+                }
+                static const char padding[4] = {0, 0, 0, 0};
+                out.write(padding, (4 - written % 4) % 4);
+
+                out.write((const char *) mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+                out.write((const char *) mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+                out.write((const char *) mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+            }
+            if (!out)
+                return false;
+        }
+        if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x434d4752; // "RGMC"
+    static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+    static void hashBytes(const void *data, size_t size, uint64_t &hash)
+    {
+        const unsigned char *bytes = (const unsigned char *) data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    }
+
+    struct MeshCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t postProcessFlags;
+        uint64_t sourceHash;
+        uint32_t meshCount;
+        uint32_t reserved;
+    };
+
+    // read-only memory mapping of a whole file, unmapped on destruction
+    struct MappedFile {
+        void  *data = nullptr;
+        size_t size = 0;
+
+        bool open(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+                ::close(fd);
+                return false;
+            }
+            void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED)
+                return false;
+            data = mapped;
+            size = st.st_size;
+            return true;
+        }
+
+        ~MappedFile()
+        {
+            if (data)
+                munmap(data, size);
+        }
+    };
+
+    // bounds-checked cursor over the mapped cache file
+    struct Reader {
+        const char *data;
+        size_t      size;
+        size_t      offset;
+
+        size_t remaining() const
+        {
+            return size - offset;
+        }
+
+        bool read(void *dst, size_t bytes)
+        {
+            if (bytes > remaining())
+                return false;
+            if (bytes)
+                std::memcpy(dst, data + offset, bytes);
+            offset += bytes;
+            return true;
+        }
+
+        bool readString(std::string &str)
+        {
+            uint32_t length;
+            if (!read(&length, sizeof(length)) || length > size - offset)
+                return false;
+            str.assign(data + offset, length);
+            offset += length;
+            return true;
+        }
+
+        void align()
+        {
+            offset = (offset + 3) & ~(size_t) 3;
+            if (offset > size)
+                offset = size;
+        }
+    };
+
+    static size_t writeString(std::ofstream &out, const std::string &str)
+    {
+        uint32_t length = (uint32_t) str.size();
+        out.write((const char *) &length, sizeof(length));
+        out.write(str.data(), length);
+        return sizeof(length) + length;
+    }
+};
+
+#endif
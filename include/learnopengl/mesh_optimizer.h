@@ -0,0 +1,295 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/lod.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// post-transform vertex cache statistics of a triangle list, for a FIFO cache
+struct VertexCacheStats {
+    // average cache miss ratio: transformed vertices per triangle, 0.5 at best for large regular meshes
+    float acmr = 0.0f;
+    // average transform to vertex ratio: transformed vertices per referenced vertex, 1 at best
+    float atvr = 0.0f;
+    size_t misses = 0;
+    size_t triangles = 0;
+    size_t uniqueVertices = 0;
+};
+
+// Reorders imported index and vertex buffers for the GPU, without changing what is drawn:
+//   OptimizeVertexCache  triangle order for the post-transform cache (Tipsify, Sander et al. 2007)
+//   OptimizeOverdraw     cache-friendly clusters of that order sorted outside-in, so the front-most
+//                        surfaces tend to be drawn first and hide the rest early
+//   OptimizeVertexFetch  vertex order by first use, so vertex fetches walk the buffer forward
+// Optimize runs all three on every level of detail of a mesh. Each step also works on its own.
+class MeshOptimizer
+{
+public:
+    // cache size Tipsify optimizes for; smaller than most hardware caches so the order degrades gracefully
+    static const unsigned int CACHE_SIZE = 16;
+    // clusters may be split until their miss ratio is this much worse than the whole cluster
+    static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    static void Optimize(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, const std::vector<MeshLod> &lods)
+    {
+        for (const MeshLod &lod: lods) {
+            unsigned int *range = indices.data() + lod.indexOffset;
+            OptimizeVertexCache(range, lod.indexCount, vertices.size());
+            OptimizeOverdraw(range, lod.indexCount, vertices);
+        }
+        OptimizeVertexFetch(vertices, indices);
+    }
+
+    // Tipsify: fans around the vertex that will stay in the cache longest among those just used, jumping
+    // to a recently used or the next unfinished vertex when the fan runs out of triangles
+    static void OptimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles around each vertex (CSR), and how many of them are still to be emitted
+        std::vector<unsigned int> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            liveTriangles[indices[i]]++;
+        std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        std::vector<unsigned int> adjacency(triangleCount * 3);
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+
+        std::vector<unsigned int> result;
+        result.reserve(triangleCount * 3);
+        std::vector<char> emitted(triangleCount, 0);
+        std::vector<unsigned int> cacheTime(vertexCount, 0);
+        std::vector<unsigned int> deadEnds;
+        std::vector<unsigned int> candidates;
+        unsigned int time = cacheSize + 1;
+        size_t cursor = 0;
+
+        long fanning = indices[0];
+        while (fanning >= 0) {
+            candidates.clear();
+            for (unsigned int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+                unsigned int triangle = adjacency[a];
+                if (emitted[triangle])
+                    continue;
+                emitted[triangle] = 1;
+                for (int corner = 0; corner < 3; corner++) {
+                    unsigned int v = indices[triangle * 3 + corner];
+                    result.push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    liveTriangles[v]--;
+                    if (time - cacheTime[v] > cacheSize)
+                        cacheTime[v] = time++;
+                }
+            }
+            fanning = nextFanningVertex(candidates, deadEnds, liveTriangles, cacheTime, time, cacheSize, cursor);
+        }
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    // Splits the (cache optimized) triangle order into clusters at the points where the cache starts over
+    // anyway, or where the miss ratio is still close to that of the whole cluster, and sorts the clusters
+    // by how far out they face from the mesh center. Costs a little cache efficiency for less overdraw.
+    static void OptimizeOverdraw(unsigned int *indices, size_t indexCount, const std::vector<Vertex> &vertices,
+                                 unsigned int cacheSize = CACHE_SIZE, float threshold = OVERDRAW_THRESHOLD)
+    {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+            return;
+
+        FifoCache cache(vertices.size(), cacheSize);
+        std::vector<size_t> hardBoundaries;
+        for (size_t t = 0; t < triangleCount; t++)
+            if (cache.Access(indices + t * 3) == 3 || t == 0)
+                hardBoundaries.push_back(t);
+        hardBoundaries.push_back(triangleCount);
+
+        std::vector<size_t> clusters;
+        for (size_t c = 0; c + 1 < hardBoundaries.size(); c++) {
+            size_t start = hardBoundaries[c], end = hardBoundaries[c + 1];
+            cache.Reset();
+            size_t clusterMisses = 0;
+            for (size_t t = start; t < end; t++)
+                clusterMisses += cache.Access(indices + t * 3);
+            float clusterThreshold = threshold * clusterMisses / (end - start);
+
+            clusters.push_back(start);
+            cache.Reset();
+            size_t misses = 0, faces = 0;
+            for (size_t t = start; t + 1 < end; t++) {
+                misses += cache.Access(indices + t * 3);
+                faces++;
+                if ((float) misses / faces <= clusterThreshold) {
+                    clusters.push_back(t + 1);
+                    cache.Reset();
+                    misses = faces = 0;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // sort key: offset of the cluster centroid from the mesh centroid along the cluster normal
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        size_t clusterCount = clusters.size() - 1;
+        std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+        std::vector<float> clusterAreas(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; c++) {
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+                const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+                clusterNormals[c] += normal;
+                clusterAreas[c] += area;
+            }
+            meshCentroid += clusterCentroids[c];
+            meshArea += clusterAreas[c];
+        }
+        if (meshArea > 0.0f)
+            meshCentroid /= meshArea;
+        std::vector<float> sortKeys(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; c++) {
+            if (clusterAreas[c] <= 0.0f)
+                continue;
+            glm::vec3 centroid = clusterCentroids[c] / clusterAreas[c];
+            float normalLength = glm::length(clusterNormals[c]);
+            if (normalLength > 0.0f)
+                sortKeys[c] = glm::dot(centroid - meshCentroid, clusterNormals[c] / normalLength);
+        }
+
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+        std::vector<unsigned int> result;
+        result.reserve(triangleCount * 3);
+        for (size_t c: order)
+            result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    // reorders the vertices by their first use in indices and rewrites indices to match; vertices no
+    // index refers to are kept at the end
+    static void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        const unsigned int unassigned = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), unassigned);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+        for (unsigned int &index: indices) {
+            if (remap[index] == unassigned) {
+                remap[index] = reordered.size();
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        for (size_t v = 0; v < vertices.size(); v++)
+            if (remap[v] == unassigned)
+                reordered.push_back(vertices[v]);
+        vertices.swap(reordered);
+    }
+
+    static VertexCacheStats AnalyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                               unsigned int cacheSize = CACHE_SIZE)
+    {
+        VertexCacheStats stats;
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<char> referenced(vertexCount, 0);
+        stats.triangles = indexCount / 3;
+        for (size_t t = 0; t < stats.triangles; t++)
+            stats.misses += cache.Access(indices + t * 3);
+        for (size_t i = 0; i < stats.triangles * 3; i++) {
+            if (!referenced[indices[i]])
+                stats.uniqueVertices++;
+            referenced[indices[i]] = 1;
+        }
+        if (stats.triangles > 0)
+            stats.acmr = (float) stats.misses / stats.triangles;
+        if (stats.uniqueVertices > 0)
+            stats.atvr = (float) stats.misses / stats.uniqueVertices;
+        return stats;
+    }
+
+private:
+    // FIFO post-transform cache: a vertex is cached while fewer than size others were inserted after it
+    class FifoCache
+    {
+    public:
+        FifoCache(size_t vertexCount, unsigned int size)
+                : size(size), insertedAt(vertexCount, 0), counter(size + 1) {}
+
+        // misses of the three corners of a triangle
+        unsigned int Access(const unsigned int *triangle)
+        {
+            unsigned int misses = 0;
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int v = triangle[corner];
+                if (counter - insertedAt[v] > size) {
+                    insertedAt[v] = counter++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        void Reset()
+        {
+            counter += size + 1;
+        }
+
+    private:
+        unsigned int size;
+        std::vector<unsigned int> insertedAt;
+        unsigned int counter;
+    };
+
+    // the candidate that stays cached longest after fanning around it, else a recent vertex with
+    // triangles left, else the next unfinished vertex in index order; -1 when everything is emitted
+    static long nextFanningVertex(const std::vector<unsigned int> &candidates, std::vector<unsigned int> &deadEnds,
+                                  const std::vector<unsigned int> &liveTriangles, const std::vector<unsigned int> &cacheTime,
+                                  unsigned int time, unsigned int cacheSize, size_t &cursor)
+    {
+        long best = -1;
+        long bestPriority = -1;
+        for (unsigned int v: candidates) {
+            if (liveTriangles[v] == 0)
+                continue;
+            long priority = 0;
+            // still cached after its remaining triangles (at most two new vertices each) are emitted
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority) {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+        if (best >= 0)
+            return best;
+
+        while (!deadEnds.empty()) {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0)
+                return v;
+        }
+        for (; cursor < liveTriangles.size(); cursor++)
+            if (liveTriangles[cursor] > 0)
+                return cursor;
+        return -1;
+    }
+};
+
+#endif
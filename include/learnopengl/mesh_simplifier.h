@@ -0,0 +1,372 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/lod.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+// Quadric error metric simplification (Garland & Heckbert) with half-edge collapses: a vertex is always
+// merged into one of its neighbours, so simplified levels are only new index lists over the original
+// vertex buffer.
+//
+// Corners that share position, normal and texture coordinates are welded first, the importer leaves
+// them separate. A position with several distinct attribute sets lies on a seam and never moves, open
+// borders (leaf cards, cut-outs) only collapse along themselves and carry an extra quadric that keeps
+// their outline. Collapses are done in passes over the edges sorted by cost; every collapse locks the
+// neighbourhood it changed until the next pass so the flip test always sees current geometry.
+class MeshSimplifier
+{
+public:
+    // levels per mesh including the full detail one
+    static const int MAX_LEVELS = 4;
+
+    // Appends the index lists of up to MAX_LEVELS - 1 simplified levels to indices, each with about half
+    // the triangles of the previous one, and describes all levels in lods. Stops early once a level can
+    // not be reduced enough within the error limit.
+    static void BuildLodChain(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, std::vector<MeshLod> &lods)
+    {
+        lods.clear();
+        lods.push_back(MeshLod{0, (unsigned int) indices.size(), 0.0f});
+        if (indices.size() < MIN_INDICES)
+            return;
+
+        AABB box;
+        for (const Vertex &vertex: vertices)
+            box.Expand(vertex.Position);
+        float maxError = glm::length(box.Extents()) * MAX_RELATIVE_ERROR;
+
+        std::vector<unsigned int> level(indices);
+        for (int i = 1; i < MAX_LEVELS; i++) {
+            const MeshLod &previous = lods.back();
+            float error = 0.0f;
+            level = Simplify(vertices, level, previous.indexCount / 6 * 3, maxError, error);
+            if (level.size() > previous.indexCount * 9 / 10)
+                break;
+            // every level is simplified from the previous one, so their errors add up
+            lods.push_back(MeshLod{(unsigned int) indices.size(), (unsigned int) level.size(), previous.error + error});
+            indices.insert(indices.end(), level.begin(), level.end());
+        }
+    }
+
+    // Collapses edges of the triangle list until at most targetIndexCount indices are left or the next
+    // collapse would exceed maxError (model units). error receives the largest error introduced.
+    static std::vector<unsigned int> Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                              size_t targetIndexCount, float maxError, float &error)
+    {
+        error = 0.0f;
+        size_t vertexCount = vertices.size();
+
+        // welded[v]: first vertex at the same position, the vertex the simplifier works with.
+        // unique[v]: first vertex with the same position, normal and texture coordinates.
+        std::vector<unsigned int> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [&vertices](unsigned int a, unsigned int b) {
+            return attributeKey(vertices[a]) < attributeKey(vertices[b]);
+        });
+        std::vector<unsigned int> welded(vertexCount), unique(vertexCount);
+        std::vector<unsigned char> kind(vertexCount, INTERIOR);
+        for (size_t i = 0; i < vertexCount; i++) {
+            unsigned int v = order[i], previous = i > 0 ? order[i - 1] : v;
+            welded[v] = unique[v] = v;
+            if (i == 0 || vertices[previous].Position != vertices[v].Position)
+                continue;
+            welded[v] = welded[previous];
+            if (attributeKey(vertices[previous]) == attributeKey(vertices[v]))
+                unique[v] = unique[previous];
+            else
+                kind[welded[v]] = SEAM;
+        }
+
+        std::vector<unsigned int> corners;
+        corners.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            unsigned int a = unique[indices[i]], b = unique[indices[i + 1]], c = unique[indices[i + 2]];
+            if (welded[a] != welded[b] && welded[b] != welded[c] && welded[c] != welded[a]) {
+                corners.push_back(a);
+                corners.push_back(b);
+                corners.push_back(c);
+            }
+        }
+        auto position = [&](unsigned int corner) -> const glm::vec3 & { return vertices[welded[corner]].Position; };
+
+        // plane quadrics of the triangles, weighted by area
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < corners.size(); i += 3) {
+            glm::vec3 normal = glm::cross(position(corners[i + 1]) - position(corners[i]), position(corners[i + 2]) - position(corners[i]));
+            float doubleArea = glm::length(normal);
+            if (doubleArea == 0.0f)
+                continue;
+            normal /= doubleArea;
+            for (int k = 0; k < 3; k++)
+                quadrics[welded[corners[i + k]]].AddPlane(normal, -glm::dot(normal, position(corners[i])), 0.5f * doubleArea);
+        }
+
+        // edges used by a single triangle are borders: their endpoints get a quadric of the plane through
+        // the edge perpendicular to the triangle and may only slide along the border
+        std::vector<Edge> edges;
+        collectEdges(corners, welded, edges);
+        for (size_t i = 0; i < edges.size(); i++) {
+            bool border = (i == 0 || !edges[i - 1].SameAs(edges[i])) && (i + 1 == edges.size() || !edges[i + 1].SameAs(edges[i]));
+            if (!border)
+                continue;
+            const Edge &edge = edges[i];
+            size_t triangle = edge.triangle * 3;
+            glm::vec3 triangleNormal = glm::cross(position(corners[triangle + 1]) - position(corners[triangle]),
+                                                  position(corners[triangle + 2]) - position(corners[triangle]));
+            glm::vec3 along = vertices[edge.b].Position - vertices[edge.a].Position;
+            glm::vec3 normal = glm::cross(along, triangleNormal);
+            float length = glm::length(normal);
+            if (length == 0.0f)
+                continue;
+            normal /= length;
+            float weight = glm::dot(along, along) * BORDER_WEIGHT;
+            for (unsigned int v: {edge.a, edge.b}) {
+                quadrics[v].AddPlane(normal, -glm::dot(normal, vertices[v].Position), weight);
+                if (kind[v] == INTERIOR)
+                    kind[v] = BORDER;
+            }
+        }
+
+        const unsigned int NONE = ~0u;
+        std::vector<unsigned int> collapseTo(vertexCount, NONE);
+        std::vector<unsigned int> replacement(vertexCount);
+        std::vector<unsigned char> locked(vertexCount);
+        std::vector<unsigned int> adjacencyOffsets, adjacency;
+        std::vector<Collapse> collapses;
+        double maxErrorSquared = (double) maxError * maxError;
+        double worstError = 0.0;
+        size_t targetTriangles = targetIndexCount / 3;
+
+        while (corners.size() / 3 > targetTriangles) {
+            size_t triangleCount = corners.size() / 3;
+
+            // triangles around every welded vertex
+            adjacencyOffsets.assign(vertexCount + 1, 0);
+            for (unsigned int corner: corners)
+                adjacencyOffsets[welded[corner] + 1]++;
+            std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+            adjacency.resize(corners.size());
+            {
+                std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t i = 0; i < corners.size(); i++)
+                    adjacency[fill[welded[corners[i]]]++] = (unsigned int) (i / 3);
+            }
+
+            // cheapest allowed direction of every edge
+            collectEdges(corners, welded, edges);
+            collapses.clear();
+            for (size_t i = 0; i < edges.size(); i++) {
+                if (i > 0 && edges[i - 1].SameAs(edges[i]))
+                    continue;
+                bool border = i + 1 == edges.size() || !edges[i + 1].SameAs(edges[i]);
+                Collapse best{0, 0, -1.0};
+                for (int direction = 0; direction < 2; direction++) {
+                    unsigned int u = direction ? edges[i].b : edges[i].a;
+                    unsigned int v = direction ? edges[i].a : edges[i].b;
+                    if (kind[u] == SEAM || (kind[u] == BORDER && !border))
+                        continue;
+                    Quadric merged = quadrics[u];
+                    merged.Add(quadrics[v]);
+                    double cost = merged.Error(vertices[v].Position);
+                    if (best.cost < 0.0 || cost < best.cost)
+                        best = Collapse{u, v, cost};
+                }
+                if (best.cost >= 0.0)
+                    collapses.push_back(best);
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+            if (collapses.empty())
+                break;
+
+            // a collapse removes about two triangles; collapses much costlier than the ones needed to reach
+            // the target wait for the next pass, where cheaper ones may have opened up around them
+            size_t goal = std::min((triangleCount - targetTriangles) / 2, collapses.size() - 1);
+            double passLimit = std::min(collapses[goal].cost * PASS_COST_SLACK, maxErrorSquared);
+
+            std::fill(locked.begin(), locked.end(), 0);
+            size_t collapsed = 0;
+            for (const Collapse &collapse: collapses) {
+                if (collapse.cost > passLimit)
+                    break;
+                unsigned int u = collapse.u, v = collapse.v;
+                if (locked[u] || locked[v] || flips(u, v, corners, welded, vertices, adjacencyOffsets, adjacency))
+                    continue;
+
+                // triangles on the edge disappear, the others around u take over v's corner from one of them
+                size_t removed = 0;
+                for (unsigned int a = adjacencyOffsets[u]; a < adjacencyOffsets[u + 1]; a++) {
+                    const unsigned int *triangle = &corners[adjacency[a] * 3];
+                    for (int k = 0; k < 3; k++) {
+                        if (welded[triangle[k]] == v) {
+                            replacement[u] = triangle[k];
+                            removed++;
+                        }
+                    }
+                }
+                collapseTo[u] = v;
+                quadrics[v].Add(quadrics[u]);
+                worstError = std::max(worstError, collapse.cost);
+                for (unsigned int a = adjacencyOffsets[u]; a < adjacencyOffsets[u + 1]; a++)
+                    for (int k = 0; k < 3; k++)
+                        locked[welded[corners[adjacency[a] * 3 + k]]] = 1;
+                collapsed++;
+                triangleCount -= removed;
+                if (triangleCount <= targetTriangles)
+                    break;
+            }
+            if (collapsed == 0)
+                break;
+
+            size_t written = 0;
+            for (size_t i = 0; i < corners.size(); i += 3) {
+                unsigned int triangle[3];
+                for (int k = 0; k < 3; k++) {
+                    unsigned int corner = corners[i + k];
+                    triangle[k] = collapseTo[welded[corner]] != NONE ? replacement[welded[corner]] : corner;
+                }
+                if (welded[triangle[0]] == welded[triangle[1]] || welded[triangle[1]] == welded[triangle[2]] ||
+                    welded[triangle[2]] == welded[triangle[0]])
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    corners[written++] = triangle[k];
+            }
+            corners.resize(written);
+            std::fill(collapseTo.begin(), collapseTo.end(), NONE);
+        }
+
+        error = (float) std::sqrt(worstError);
+        return corners;
+    }
+
+private:
+    // meshes smaller than this are drawn at full detail only
+    static const size_t MIN_INDICES = 3 * 64;
+    // collapses stop once they would move the surface by this fraction of the mesh size
+    static constexpr float MAX_RELATIVE_ERROR = 0.25f;
+    static constexpr float BORDER_WEIGHT = 10.0f;
+    static constexpr double PASS_COST_SLACK = 1.5;
+
+    enum VertexKind : unsigned char {
+        INTERIOR,
+        BORDER,
+        SEAM
+    };
+
+    // symmetric 4x4 matrix of the summed squared plane distances, with the summed plane weights
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+        double weight = 0;
+
+        void AddPlane(const glm::vec3 &normal, float distance, float planeWeight)
+        {
+            double x = normal.x, y = normal.y, z = normal.z, d = distance, w = planeWeight;
+            a00 += w * x * x; a01 += w * x * y; a02 += w * x * z; a03 += w * x * d;
+            a11 += w * y * y; a12 += w * y * z; a13 += w * y * d;
+            a22 += w * z * z; a23 += w * z * d;
+            a33 += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric &q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+        }
+
+        // weighted mean squared distance of p to the planes
+        double Error(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double sum = a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+                         2.0 * (a01 * x * y + a02 * x * z + a03 * x + a12 * y * z + a13 * y + a23 * z);
+            return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    // undirected edge between welded vertices a < b, seen from triangle
+    struct Edge {
+        unsigned int a, b, triangle;
+
+        bool SameAs(const Edge &other) const
+        {
+            return a == other.a && b == other.b;
+        }
+    };
+
+    struct Collapse {
+        unsigned int u, v;
+        double cost;
+    };
+
+    struct AttributeKey {
+        float values[8];
+
+        bool operator<(const AttributeKey &other) const
+        {
+            return std::lexicographical_compare(values, values + 8, other.values, other.values + 8);
+        }
+
+        bool operator==(const AttributeKey &other) const
+        {
+            return std::equal(values, values + 8, other.values);
+        }
+    };
+
+    // position first so equal positions sort next to each other
+    static AttributeKey attributeKey(const Vertex &vertex)
+    {
+        return AttributeKey{{vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.Normal.x, vertex.Normal.y,
+                             vertex.Normal.z, vertex.TexCoords.x, vertex.TexCoords.y}};
+    }
+
+    // all triangle edges, sorted so the copies of an edge are adjacent
+    static void collectEdges(const std::vector<unsigned int> &corners, const std::vector<unsigned int> &welded, std::vector<Edge> &edges)
+    {
+        edges.clear();
+        for (size_t i = 0; i < corners.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = welded[corners[i + k]], b = welded[corners[i + (k + 1) % 3]];
+                edges.push_back(Edge{std::min(a, b), std::max(a, b), (unsigned int) (i / 3)});
+            }
+        }
+        std::sort(edges.begin(), edges.end(), [](const Edge &x, const Edge &y) {
+            return x.a != y.a ? x.a < y.a : x.b < y.b;
+        });
+    }
+
+    // true if moving u onto v turns a surviving triangle around u upside down
+    static bool flips(unsigned int u, unsigned int v, const std::vector<unsigned int> &corners, const std::vector<unsigned int> &welded,
+                      const std::vector<Vertex> &vertices, const std::vector<unsigned int> &adjacencyOffsets,
+                      const std::vector<unsigned int> &adjacency)
+    {
+        for (unsigned int a = adjacencyOffsets[u]; a < adjacencyOffsets[u + 1]; a++) {
+            const unsigned int *triangle = &corners[adjacency[a] * 3];
+            glm::vec3 before[3], after[3];
+            bool onEdge = false;
+            for (int k = 0; k < 3; k++) {
+                unsigned int w = welded[triangle[k]];
+                onEdge = onEdge || w == v;
+                before[k] = vertices[w].Position;
+                after[k] = w == u ? vertices[v].Position : before[k];
+            }
+            if (onEdge)
+                continue;
+            glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+                return true;
+        }
+        return false;
+    }
+};
+
+#endif
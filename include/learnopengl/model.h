@@ -11,7 +11,13 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/lod.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/bounds.h>
 
 #include <string>
 #include <fstream>
@@ -19,9 +25,21 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <utility>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+// decoded image kept on the CPU until it is uploaded on the GL thread
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char *pixels = nullptr;
+};
+
+TextureLayer TextureFromFile(const char *path, const string &directory, bool gamma = false);
+ImageData DecodeImage(const char *path, const string &directory);
+TextureLayer UploadTexture(const ImageData &image, const char *path);
+void FreeImage(ImageData &image);
 
 
 
@@ -33,6 +51,9 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // model space bounds of all meshes
+    AABB Box;
+    BoundingSphere Sphere;
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
@@ -40,63 +61,506 @@ public:
         loadModel(path);
     }
 
+    // empty model, filled in asynchronously by ModelLoader
+    Model() : gammaCorrection(false)
+    {
+    }
+
+    // a model only becomes drawable once all of its meshes and textures are uploaded
+    bool IsReady() const
+    {
+        return ready;
+    }
+
+    // number of levels of detail of the most detailed mesh
+    int LodCount() const
+    {
+        return lodCount;
+    }
+
+    // GPU memory of the vertex buffers of all meshes
+    size_t VertexBufferBytes() const
+    {
+        size_t bytes = 0;
+        for (const Mesh &mesh: meshes)
+            bytes += mesh.VertexBufferBytes();
+        return bytes;
+    }
+
+    // GPU memory of the index buffers of all meshes
+    size_t IndexBufferBytes() const
+    {
+        size_t bytes = 0;
+        for (const Mesh &mesh: meshes)
+            bytes += mesh.IndexBufferBytes();
+        return bytes;
+    }
+
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        if (!ready)
+            return;
+        drawCommands.clear();
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            drawCommands.push_back(Mesh::DrawCommand{&meshes[i], 0, 0, 0, 0});
+        Mesh::Submit(shader, drawCommands.data(), drawCommands.size());
     }
 
-    void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+    // draws every copy of the model in one instanced draw call per mesh. The per-instance model
+    // matrices are streamed into a buffer owned by the model and read as vertex attributes 5-8,
+    // so the shader has to be an instanced variant (e.g. 2.model_lighting_instanced.vs).
+    void DrawInstanced(Shader &shader, const glm::mat4 *modelMatrices, size_t instanceCount)
+    {
+        if (!ready || instanceCount == 0)
+            return;
+
+        uploadInstances(modelMatrices, instanceCount);
+        drawCommands.clear();
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            drawCommands.push_back(Mesh::DrawCommand{&meshes[i], 0, (GLsizei) instanceCount, instanceVBO, 0});
+        Mesh::Submit(shader, drawCommands.data(), drawCommands.size());
+    }
+
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &modelMatrices)
+    {
+        DrawInstanced(shader, modelMatrices.data(), modelMatrices.size());
+    }
+
+    // draws the meshes whose bounds, placed with modelMatrix, intersect the frustum. The whole model is
+    // rejected with its sphere and box first. A null frustum draws everything. modelMatrix is only used
+    // for the tests, setting the shader uniform is up to the caller.
+    // With a lod selector every mesh is drawn at the level chosen for the whole model. While it cross-fades
+    // the two levels are drawn with complementary dither patterns, passed to the shader through lodFade:
+    // 1 - fade keeps that fraction of the finer level, -fade the rest for the coarser one, 0 is opaque.
+    void Draw(Shader &shader, const glm::mat4 &modelMatrix, const Frustum *frustum, CullStats &stats,
+              const LodSelector *lod = nullptr, Uniform<float> lodFade = Uniform<float>())
+    {
+        LodChoice choice = collectDraws(modelMatrix, frustum, stats, lod);
+        if (drawCommands.empty())
+            return;
+        if (choice.fade <= 0.0f)
+        {
+            Mesh::Submit(shader, drawCommands.data(), drawCommands.size());
+            return;
         }
+
+        // the finer level first, then the same meshes at the coarser one
+        lodFade.set(1.0f - choice.fade);
+        Mesh::Submit(shader, drawCommands.data(), drawCommands.size());
+        coarsenDraws(choice, stats);
+        lodFade.set(-choice.fade);
+        Mesh::Submit(shader, drawCommands.data(), drawCommands.size());
+        lodFade.set(0.0f);
     }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    // queues the draws Draw would issue. state gives the program, face culling and uniform locations, its
+    // model matrix and lod fade are filled in here; each mesh is ordered by the distance to its center.
+    void Enqueue(RenderQueue &queue, unsigned int pass, RenderState state, const glm::mat4 &modelMatrix,
+                 const Frustum *frustum, CullStats &stats, const LodSelector *lod = nullptr)
+    {
+        LodChoice choice = collectDraws(modelMatrix, frustum, stats, lod);
+        if (drawCommands.empty())
+            return;
+        state.model = modelMatrix;
+        state.lodFade = choice.fade > 0.0f ? 1.0f - choice.fade : 0.0f;
+        unsigned int stateIndex = queue.AddState(state);
+        for (const Mesh::DrawCommand &command: drawCommands)
+            queue.Add(pass, stateIndex, command, glm::vec3(modelMatrix * glm::vec4(command.mesh->Sphere.center, 1.0f)));
+        if (choice.fade <= 0.0f)
+            return;
+
+        coarsenDraws(choice, stats);
+        state.lodFade = -choice.fade;
+        stateIndex = queue.AddState(state);
+        for (const Mesh::DrawCommand &command: drawCommands)
+            queue.Add(pass, stateIndex, command, glm::vec3(modelMatrix * glm::vec4(command.mesh->Sphere.center, 1.0f)));
+    }
+
+    // instanced draw of only the copies whose bounds intersect the frustum, a null frustum draws all of them.
+    // With a lod selector the copies are grouped by level and each group is drawn with its own instanced
+    // draw calls. The instanced shader reads the cross-fade of a copy (see Draw) from the otherwise unused
+    // [0][3] element of its model matrix.
+    void DrawInstanced(Shader &shader, const glm::mat4 *modelMatrices, size_t instanceCount, const Frustum *frustum,
+                       CullStats &stats, const LodSelector *lod = nullptr)
+    {
+        collectInstancedDraws(modelMatrices, instanceCount, frustum, stats, lod);
+        if (!drawCommands.empty())
+            Mesh::Submit(shader, drawCommands.data(), drawCommands.size());
+    }
+
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &modelMatrices, const Frustum *frustum, CullStats &stats,
+                       const LodSelector *lod = nullptr)
+    {
+        DrawInstanced(shader, modelMatrices.data(), modelMatrices.size(), frustum, stats, lod);
+    }
+
+    // queues the draws DrawInstanced would issue with state, which needs no model matrix. The instance
+    // buffer is filled now, so the model can only be queued once per execution of the queue.
+    void EnqueueInstanced(RenderQueue &queue, unsigned int pass, const RenderState &state, const glm::mat4 *modelMatrices,
+                          size_t instanceCount, const Frustum *frustum, CullStats &stats, const LodSelector *lod = nullptr)
+    {
+        collectInstancedDraws(modelMatrices, instanceCount, frustum, stats, lod);
+        if (drawCommands.empty())
+            return;
+        unsigned int stateIndex = queue.AddState(state);
+        for (const Mesh::DrawCommand &command: drawCommands)
+            queue.Add(pass, stateIndex, command);
+    }
+
+    void EnqueueInstanced(RenderQueue &queue, unsigned int pass, const RenderState &state, const vector<glm::mat4> &modelMatrices,
+                          const Frustum *frustum, CullStats &stats, const LodSelector *lod = nullptr)
+    {
+        EnqueueInstanced(queue, pass, state, modelMatrices.data(), modelMatrices.size(), frustum, stats, lod);
+    }
+
+    static string DirectoryOf(string const &path)
+    {
+        return path.substr(0, path.find_last_of('/'));
+    }
+
+    // CPU-only part of loading, safe to call from worker threads: reads the binary mesh cache if it is
+    // up to date, otherwise imports the file with ASSIMP and rewrites the cache.
+    static bool ImportModelData(string const &path, vector<MeshData> &meshData)
+    {
+        string cachePath = MeshCache::CachePath(path);
+        uint64_t sourceHash = 0;
+        bool hashed = MeshCache::HashSource(path, sourceHash);
+        if (hashed && MeshCache::Load(cachePath, sourceHash, POST_PROCESS_FLAGS, meshData))
+            return true;
+
+        if (!ImportScene(path, meshData))
+            return false;
+        // simplified levels of detail and the GPU friendly ordering of every level are part of the cache,
+        // they only cost time on the first import
+        for (MeshData &data: meshData)
+        {
+            MeshSimplifier::BuildLodChain(data.vertices, data.indices, data.lods);
+            MeshOptimizer::Optimize(data.vertices, data.indices, data.lods);
+        }
+
+        if (hashed && !MeshCache::Save(cachePath, sourceHash, POST_PROCESS_FLAGS, meshData))
+            cout << "WARNING::MESH_CACHE:: failed to write " << cachePath << endl;
+        return true;
+    }
+
+    // imports the meshes of a file with ASSIMP as they are in the file, without levels of detail or reordering
+    static bool ImportScene(string const &path, vector<MeshData> &meshData)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, POST_PROCESS_FLAGS);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, glm::mat4(1.0f), meshData);
+        return true;
+    }
+
+    // sizes the scratch lists of DrawInstanced and EnqueueInstanced for up to count instances, so drawing
+    // them never grows a list in the middle of the render loop
+    void ReserveInstances(size_t count)
+    {
+        visibleInstances.reserve(count);
+        // an instance that cross-fades is in two levels
+        for (vector<glm::mat4> &level: lodInstances)
+            level.reserve(count);
+        sortedInstances.reserve(2 * count);
+    }
+
+    // GL part of loading: creates the meshes and textures from imported data and pre-decoded images
+    // (keyed by the texture path as referenced by the material), then marks the model as drawable.
+    void Upload(string const &modelDirectory, const vector<MeshData> &meshData, const map<string, ImageData> &images)
+    {
+        directory = modelDirectory;
+        // all meshes quantize their positions against the box of the whole model, so shared seams match
+        AABB positionBounds;
+        for (const MeshData &data: meshData)
+            for (const Vertex &vertex: data.vertices)
+                positionBounds.Expand(vertex.Position);
+        for (const MeshData &data: meshData)
+        {
+            meshes.push_back(Mesh(data.vertices, data.indices, loadMaterialTextures(data.textures, images), data.lods, &positionBounds));
+            Box.Expand(meshes.back().Box);
+        }
+        // at most one draw per mesh and level
+        drawCommands.reserve(meshes.size() * MeshSimplifier::MAX_LEVELS);
+        // the meshes switch levels together, a model level is as coarse as its coarsest mesh at that level
+        lodCount = 1;
+        for (const Mesh &mesh: meshes)
+            lodCount = std::max(lodCount, (int) mesh.Lods.size());
+        if (lodCount > MeshSimplifier::MAX_LEVELS)
+            lodCount = MeshSimplifier::MAX_LEVELS;
+        for (int level = 0; level < lodCount; level++)
+        {
+            lodErrors[level] = level > 0 ? lodErrors[level - 1] : 0.0f;
+            for (const Mesh &mesh: meshes)
+                lodErrors[level] = std::max(lodErrors[level], mesh.Lod(level).error);
+        }
+        // one sphere around the box center reaching the furthest mesh sphere
+        if (!Box.IsEmpty())
+        {
+            Sphere.center = Box.Center();
+            Sphere.radius = 0.0f;
+            for (const Mesh &mesh: meshes)
+                if (!mesh.Sphere.IsEmpty())
+                    Sphere.radius = std::max(Sphere.radius, glm::length(mesh.Sphere.center - Sphere.center) + mesh.Sphere.radius);
+        }
+        ready = true;
+    }
+
+private:
+    // post-processing applied on import, part of the mesh cache key
+    static const unsigned int POST_PROCESS_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    bool ready = false;
+    // per-instance model matrices for DrawInstanced
+    unsigned int instanceVBO = 0;
+    size_t instanceCapacity = 0;
+    // scratch list of the instances that passed culling
+    vector<glm::mat4> visibleInstances;
+    // levels of detail, the simplification error of each level in model units
+    int lodCount = 1;
+    float lodErrors[MeshSimplifier::MAX_LEVELS] = {};
+    // scratch lists of the instances per level and of all of them ordered by level
+    vector<glm::mat4> lodInstances[MeshSimplifier::MAX_LEVELS];
+    vector<glm::mat4> sortedInstances;
+    // scratch list of the draws of a Draw, DrawInstanced or Enqueue call, submitted together
+    vector<Mesh::DrawCommand> drawCommands;
+
+    // fills drawCommands with the meshes Draw draws at the finer level of the returned choice
+    LodChoice collectDraws(const glm::mat4 &modelMatrix, const Frustum *frustum, CullStats &stats, const LodSelector *lod)
+    {
+        drawCommands.clear();
+        if (!ready)
+            return LodChoice();
+        if (frustum && !isVisible(modelMatrix, *frustum))
+        {
+            stats.objectsCulled++;
+            stats.meshesCulled += meshes.size();
+            return LodChoice();
+        }
+        stats.objectsDrawn++;
+        LodChoice choice = lod ? selectLod(modelMatrix, *lod) : LodChoice();
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (frustum && meshes.size() > 1 && !frustum->Intersects(meshes[i].Box.Transformed(modelMatrix)))
+            {
+                stats.meshesCulled++;
+                continue;
+            }
+            stats.meshesDrawn++;
+            stats.trianglesDrawn += meshes[i].Lod(choice.level).indexCount / 3;
+            drawCommands.push_back(Mesh::DrawCommand{&meshes[i], choice.level, 0, 0, 0});
+        }
+        return choice;
+    }
+
+    // moves the collected draws to the coarser level of a cross-fade
+    void coarsenDraws(const LodChoice &choice, CullStats &stats)
+    {
+        for (Mesh::DrawCommand &command: drawCommands)
+        {
+            command.lod = choice.level + 1;
+            stats.trianglesDrawn += command.mesh->Lod(command.lod).indexCount / 3;
+        }
+    }
+
+    // uploads the visible instances grouped by level and fills drawCommands with their instanced draws
+    void collectInstancedDraws(const glm::mat4 *modelMatrices, size_t instanceCount, const Frustum *frustum, CullStats &stats,
+                               const LodSelector *lod)
+    {
+        drawCommands.clear();
+        if (!ready)
+            return;
+        const glm::mat4 *instances = modelMatrices;
+        size_t count = instanceCount;
+        if (frustum)
+        {
+            visibleInstances.clear();
+            for (size_t i = 0; i < instanceCount; i++)
+                if (isVisible(modelMatrices[i], *frustum))
+                    visibleInstances.push_back(modelMatrices[i]);
+            instances = visibleInstances.data();
+            count = visibleInstances.size();
+        }
+        size_t culled = instanceCount - count;
+        stats.objectsDrawn += count;
+        stats.objectsCulled += culled;
+        stats.meshesDrawn += count * meshes.size();
+        stats.meshesCulled += culled * meshes.size();
+        if (count == 0)
+            return;
+        if (!lod || lodCount <= 1)
+        {
+            uploadInstances(instances, count);
+            for (Mesh &mesh: meshes)
+            {
+                stats.trianglesDrawn += count * mesh.Lod(0).indexCount / 3;
+                drawCommands.push_back(Mesh::DrawCommand{&mesh, 0, (GLsizei) count, instanceVBO, 0});
+            }
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        for (vector<glm::mat4> &level: lodInstances)
+            level.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            const glm::mat4 &modelMatrix = instances[i];
+            LodChoice choice = selectLod(modelMatrix, *lod);
+            glm::mat4 instance = modelMatrix;
+            if (choice.fade > 0.0f)
+            {
+                instance[0][3] = -choice.fade;
+                lodInstances[choice.level + 1].push_back(instance);
+                instance[0][3] = 1.0f - choice.fade;
+            }
+            lodInstances[choice.level].push_back(instance);
+        }
+
+        // all levels go into the instance buffer back to back, each draw points the attributes at its range
+        sortedInstances.clear();
+        for (const vector<glm::mat4> &level: lodInstances)
+            sortedInstances.insert(sortedInstances.end(), level.begin(), level.end());
+        uploadInstances(sortedInstances.data(), sortedInstances.size());
+        size_t firstInstance = 0;
+        for (int level = 0; level < lodCount; level++)
+        {
+            size_t levelCount = lodInstances[level].size();
+            if (levelCount == 0)
+                continue;
+            for (Mesh &mesh: meshes)
+            {
+                stats.trianglesDrawn += levelCount * mesh.Lod(level).indexCount / 3;
+                drawCommands.push_back(Mesh::DrawCommand{&mesh, level, (GLsizei) levelCount, instanceVBO, firstInstance});
+            }
+            firstInstance += levelCount;
+        }
+    }
+
+    bool isVisible(const glm::mat4 &modelMatrix, const Frustum &frustum) const
+    {
+        return frustum.Intersects(Sphere.Transformed(modelMatrix)) && frustum.Intersects(Box.Transformed(modelMatrix));
+    }
+
+    LodChoice selectLod(const glm::mat4 &modelMatrix, const LodSelector &selector) const
+    {
+        if (lodCount <= 1 || Sphere.IsEmpty() || Sphere.radius == 0.0f)
+            return LodChoice();
+        BoundingSphere worldSphere = Sphere.Transformed(modelMatrix);
+        return selector.Select(worldSphere, lodErrors, lodCount, worldSphere.radius / Sphere.radius);
+    }
+
+    // streams instance model matrices into the instance buffer, growing it when needed
+    void uploadInstances(const glm::mat4 *modelMatrices, size_t instanceCount)
+    {
+        if (instanceVBO == 0)
+            glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (instanceCount > instanceCapacity)
+        {
+            instanceCapacity = instanceCount;
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), modelMatrices, GL_STREAM_DRAW);
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(glm::mat4), modelMatrices);
+        }
+    }
+
+    // loads a model synchronously on the calling (GL) thread
+    void loadModel(string const &path)
+    {
+        vector<MeshData> meshData;
+        if (!ImportModelData(path, meshData))
+            return;
+
+        string modelDirectory = DirectoryOf(path);
+        map<string, ImageData> images;
+        for (const MeshData &data: meshData)
+            for (const TextureRef &ref: data.textures)
+                if (images.find(ref.path) == images.end())
+                    images[ref.path] = DecodeImage(ref.path.c_str(), modelDirectory);
+
+        Upload(modelDirectory, meshData, images);
+        for (auto &image: images)
+            FreeImage(image.second);
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // The node transforms are accumulated from the root down and baked into the vertices, so the meshes of a model share one model matrix
+    // and stay drawable as one instance.
+    static void processNode(aiNode *node, const aiScene *scene, const glm::mat4 &parentTransform, vector<MeshData> &meshData)
     {
+        glm::mat4 transform = parentTransform * toMat4(node->mTransformation);
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshData.push_back(processMesh(mesh, scene));
+            if (transform != glm::mat4(1.0f))
+                transformVertices(meshData.back().vertices, transform);
+            // a mirroring transform turns the triangles inside out, swapping two corners restores the winding
+            if (glm::determinant(transform) < 0.0f)
+                flipWinding(meshData.back().indices);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, transform, meshData);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // ASSIMP matrices are row-major, glm's column-major
+    static glm::mat4 toMat4(const aiMatrix4x4 &matrix)
+    {
+        glm::mat4 result;
+        for (int row = 0; row < 4; row++)
+            for (int column = 0; column < 4; column++)
+                result[column][row] = matrix[row][column];
+        return result;
+    }
+
+    // moves the vertices of a mesh into the space of the model root; normals go through the inverse
+    // transpose, so they stay perpendicular under non-uniform scale
+    static void transformVertices(vector<Vertex> &vertices, const glm::mat4 &transform)
+    {
+        glm::mat3 linear(transform);
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+        // meshes without texture coordinates have zero tangents, which stay zero
+        auto direction = [](const glm::vec3 &v) {
+            float length = glm::length(v);
+            return length > 0.0f ? v / length : v;
+        };
+        for (Vertex &vertex: vertices)
+        {
+            vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+            vertex.Normal = direction(normalMatrix * vertex.Normal);
+            vertex.Tangent = direction(linear * vertex.Tangent);
+            vertex.Bitangent = direction(linear * vertex.Bitangent);
+        }
+    }
+
+    // swaps the last two corners of every triangle
+    static void flipWinding(vector<unsigned int> &indices)
+    {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            std::swap(indices[i + 1], indices[i + 2]);
+    }
+
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -159,43 +623,43 @@ private:
         // diffuse: texture_diffuseN
         // specular: texture_specularN
         // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data.textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", data.textures);
 
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the CPU-side mesh data, uploaded once the whole model is processed
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // records the paths of all material textures of a given type, they are loaded in loadMaterialTextures.
+    static void collectMaterialTextures(aiMaterial *mat, aiTextureType type, const string &typeName, vector<TextureRef> &textures)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
-
             aiString str;
             mat->GetTexture(type, i, &str);
+            textures.push_back(TextureRef{typeName, str.C_Str()});
+        }
+    }
+
+    // uploads the referenced material textures if they're not uploaded yet.
+    // the required info is returned as a Texture struct.
+    vector<Texture> loadMaterialTextures(const vector<TextureRef> &refs, const map<string, ImageData> &images)
+    {
+        vector<Texture> textures;
+        for(const TextureRef &ref: refs)
+        {
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
             bool skip = false;
             for(unsigned int j = 0; j < textures_loaded.size(); j++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if(textures_loaded[j].path == ref.path)
                 {
                     std::cerr << "Loaded the texture: " << textures_loaded[j].path << std::endl;
                     textures.push_back(textures_loaded[j]);
@@ -206,9 +670,11 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
+                auto image = images.find(ref.path);
+                texture.id = image != images.end() ? UploadTexture(image->second, ref.path.c_str())
+                                                   : TextureFromFile(ref.path.c_str(), this->directory);
+                texture.type = ref.type;
+                texture.path = ref.path;
                 textures.push_back(texture);
                 textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
             }
@@ -218,43 +684,45 @@ private:
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+TextureLayer TextureFromFile(const char *path, const string &directory, bool gamma)
+{
+    ImageData image = DecodeImage(path, directory);
+    TextureLayer texture = UploadTexture(image, path);
+    FreeImage(image);
+    return texture;
+}
+
+// decodes an image file, safe to call from worker threads (stbi_set_flip_vertically_on_load is set once up front)
+ImageData DecodeImage(const char *path, const string &directory)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    ImageData image;
+    // grey and alpha images are expanded to RGBA, which the material library would store as red and green
+    int fileComponents = 0;
+    int desiredComponents = stbi_info(filename.c_str(), &image.width, &image.height, &fileComponents) && fileComponents == 2 ? 4 : 0;
+    image.pixels = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, desiredComponents);
+    if (desiredComponents)
+        image.components = desiredComponents;
+    return image;
+}
 
-        stbi_image_free(data);
-    }
-    else
+// adds the image to the texture array of its size in the material library
+TextureLayer UploadTexture(const ImageData &image, const char *path)
+{
+    if (!image.pixels)
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        return TextureLayer{MaterialLibrary::MISSING_ARRAY, 0};
     }
+    return MaterialLibrary::Get().AddTexture(image.pixels, image.width, image.height, image.components);
+}
 
-    return textureID;
+void FreeImage(ImageData &image)
+{
+    if (image.pixels)
+        stbi_image_free(image.pixels);
+    image.pixels = nullptr;
 }
 #endif
@@ -0,0 +1,183 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <learnopengl/model.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads models in the background. Mesh import (mesh cache or ASSIMP) and texture decoding run as
+// independent tasks on a pool of worker threads, so startup scales with the number of cores rather
+// than with the number of assets. Finished CPU-side buffers are queued and uploaded on the GL thread
+// by ProcessUploads/WaitAll; a Model stays undrawable until all of its data has been uploaded.
+class ModelLoader
+{
+public:
+    explicit ModelLoader(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back(&ModelLoader::workerLoop, this);
+    }
+
+    ~ModelLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskAvailable.notify_all();
+        for (std::thread &worker: workers)
+            worker.join();
+    }
+
+    ModelLoader(const ModelLoader &) = delete;
+    ModelLoader &operator=(const ModelLoader &) = delete;
+
+    // queues a model for loading, the model object must stay alive until it has been uploaded
+    void Load(Model &model, const std::string &path)
+    {
+        std::shared_ptr<PendingModel> pending = std::make_shared<PendingModel>();
+        pending->model = &model;
+        pending->path = path;
+        pending->directory = Model::DirectoryOf(path);
+        pendingCount++;
+        enqueue([this, pending]() { importModel(pending); });
+    }
+
+    // uploads every model whose data has fully arrived, call once per frame on the GL thread
+    void ProcessUploads()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uploading.swap(ready);
+        }
+        for (std::shared_ptr<PendingModel> &pending: uploading)
+            upload(*pending);
+        uploading.clear();
+    }
+
+    // blocks the GL thread until every queued model is uploaded
+    void WaitAll()
+    {
+        while (pendingCount > 0) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                readyAvailable.wait(lock, [this]() { return !ready.empty(); });
+            }
+            ProcessUploads();
+        }
+    }
+
+    bool Idle() const
+    {
+        return pendingCount == 0;
+    }
+
+private:
+    struct PendingModel {
+        Model *model = nullptr;
+        std::string path;
+        std::string directory;
+        bool imported = false;
+        std::vector<MeshData> meshes;
+        // one entry per distinct texture path, each filled by its own decode task
+        std::map<std::string, ImageData> images;
+        std::atomic<size_t> remainingImages{0};
+
+        ~PendingModel()
+        {
+            for (auto &image: images)
+                FreeImage(image.second);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::deque<std::shared_ptr<PendingModel>> ready;
+    // the models ProcessUploads took from ready, kept so an idle frame does not construct a deque
+    std::deque<std::shared_ptr<PendingModel>> uploading;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable readyAvailable;
+    bool stopping = false;
+    // only touched on the GL thread
+    size_t pendingCount = 0;
+
+    void enqueue(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        taskAvailable.notify_one();
+    }
+
+    void workerLoop()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping)
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    void importModel(std::shared_ptr<PendingModel> pending)
+    {
+        pending->imported = Model::ImportModelData(pending->path, pending->meshes);
+        for (const MeshData &mesh: pending->meshes)
+            for (const TextureRef &ref: mesh.textures)
+                pending->images[ref.path];
+
+        if (pending->images.empty()) {
+            finish(pending);
+            return;
+        }
+        // the map is complete before any decode task starts, so tasks only ever write their own entry
+        pending->remainingImages = pending->images.size();
+        for (auto &image: pending->images) {
+            const std::string *texturePath = &image.first;
+            ImageData *target = &image.second;
+            enqueue([this, pending, texturePath, target]() {
+                *target = DecodeImage(texturePath->c_str(), pending->directory);
+                if (--pending->remainingImages == 0)
+                    finish(pending);
+            });
+        }
+    }
+
+    void finish(std::shared_ptr<PendingModel> pending)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(pending);
+        }
+        readyAvailable.notify_one();
+    }
+
+    void upload(PendingModel &pending)
+    {
+        if (pending.imported)
+            pending.model->Upload(pending.directory, pending.meshes, pending.images);
+        pendingCount--;
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/uniform_buffer.h>
+
+#include <vector>
+
+// Hardware occlusion culling with GL_ANY_SAMPLES_PASSED queries. Every object that passes the frustum
+// test gets its world space box rasterized, without color or depth writes, against the finished depth
+// buffer at the end of the frame. The result decides the next frame: an object whose box had no visible
+// sample is skipped on the CPU. Results are only read once available, so the pipeline never stalls;
+// while a query is still in flight the object is drawn under conditional rendering on it instead, which
+// lets the GPU drop it if the result arrives in time.
+//
+// Objects are identified by the ids handed out by Register. An object that was not tested in the
+// previous frame (outside the frustum, camera inside its box, culling off) is always considered visible,
+// so nothing pops in late when it comes back into view.
+class OcclusionCuller
+{
+public:
+    // boxes closer than this to the camera are clipped by the near plane and would falsely test hidden
+    static constexpr float CAMERA_MARGIN = 0.5f;
+
+    OcclusionCuller()
+            : boxShader("resources/shaders/occlusion_box.vs", "resources/shaders/depth_only.fs")
+    {
+        boxShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        boxCenterUniform = boxShader.uniform<glm::vec3>("boxCenter");
+        boxExtentsUniform = boxShader.uniform<glm::vec3>("boxExtents");
+
+        // unit cube, corners at -1 and 1
+        float vertices[] = {
+            -1, -1, -1,   1, -1, -1,   1,  1, -1,  -1,  1, -1,
+            -1, -1,  1,   1, -1,  1,   1,  1,  1,  -1,  1,  1
+        };
+        unsigned char indices[] = {
+            0, 1, 2, 2, 3, 0,   4, 6, 5, 6, 4, 7,
+            0, 4, 5, 5, 1, 0,   3, 2, 6, 6, 7, 3,
+            0, 3, 7, 7, 4, 0,   1, 5, 6, 6, 2, 1
+        };
+        glGenVertexArrays(1, &cubeVAO);
+        glGenBuffers(1, &cubeVBO);
+        glGenBuffers(1, &cubeEBO);
+        GLState::Get().BindVertexArray(cubeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    }
+
+    ~OcclusionCuller()
+    {
+        for (Object &object: objects)
+            glDeleteQueries(1, &object.query);
+        GLState::Get().DeleteVertexArray(cubeVAO);
+        glDeleteBuffers(1, &cubeVBO);
+        glDeleteBuffers(1, &cubeEBO);
+    }
+
+    OcclusionCuller(const OcclusionCuller &) = delete;
+    OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+    // reserves ids for count objects and returns the first one, the rest follow consecutively
+    unsigned int Register(unsigned int count = 1)
+    {
+        unsigned int first = objects.size();
+        objects.resize(objects.size() + count);
+        for (unsigned int i = first; i < objects.size(); i++)
+            glGenQueries(1, &objects[i].query);
+        return first;
+    }
+
+    // reads back the queries that finished since the last frame, call once per frame before drawing
+    void BeginFrame(const Frustum *frustum, const glm::vec3 &cameraPosition)
+    {
+        this->frustum = frustum;
+        this->cameraPosition = cameraPosition;
+        frame++;
+        for (Object &object: objects) {
+            if (object.pending) {
+                GLuint available = 0;
+                glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available) {
+                    GLuint samplesPassed = 0;
+                    glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &samplesPassed);
+                    object.occluded = samplesPassed == 0;
+                    object.pending = false;
+                }
+            }
+            if (object.testedFrame + 1 != frame)
+                object.occluded = false;
+        }
+    }
+
+    // Records the box the object is queried with at the end of this frame and returns true if its last
+    // finished query found it hidden. May be called once per pass, the box of the last call is used.
+    bool Test(unsigned int id, const AABB &worldBox)
+    {
+        Object &object = objects[id];
+        AABB nearBox = worldBox;
+        nearBox.min -= glm::vec3(CAMERA_MARGIN);
+        nearBox.max += glm::vec3(CAMERA_MARGIN);
+        bool cameraInside = glm::all(glm::greaterThanEqual(cameraPosition, nearBox.min)) &&
+                            glm::all(glm::lessThanEqual(cameraPosition, nearBox.max));
+        if (worldBox.IsEmpty() || cameraInside || (frustum && !frustum->Intersects(worldBox))) {
+            object.occluded = false;
+            return false;
+        }
+        object.box = worldBox;
+        object.testedFrame = frame;
+        return object.occluded;
+    }
+
+    // the object's query in flight, to make its draws conditional on with glBeginConditionalRender
+    // (GL_QUERY_NO_WAIT) so the GPU drops them if it finds the object hidden; 0 when none is in flight
+    GLuint ConditionQuery(unsigned int id) const
+    {
+        const Object &object = objects[id];
+        return object.pending ? object.query : 0;
+    }
+
+    // Rasterizes the boxes recorded by Test this frame against the current depth buffer. Call after the
+    // last opaque pass with its framebuffer still bound; objects whose previous query has not come back
+    // yet are skipped and keep it.
+    void IssueQueries()
+    {
+        queriesIssued = 0;
+        boxShader.use();
+        GLState &state = GLState::Get();
+        state.BindVertexArray(cubeVAO);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        state.DepthMask(GL_FALSE);
+        for (Object &object: objects) {
+            if (object.testedFrame != frame || object.pending)
+                continue;
+            boxCenterUniform.set(object.box.Center());
+            boxExtentsUniform.set(object.box.Extents());
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, object.query);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            object.pending = true;
+            queriesIssued++;
+        }
+        state.DepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    unsigned int QueriesIssued() const
+    {
+        return queriesIssued;
+    }
+
+private:
+    struct Object {
+        GLuint query = 0;
+        // a query has been issued and its result not read yet
+        bool pending = false;
+        // result of the last query that was read back
+        bool occluded = false;
+        // frame of the last Test that recorded a box
+        unsigned int testedFrame = 0;
+        AABB box;
+    };
+
+    Shader boxShader;
+    Uniform<glm::vec3> boxCenterUniform;
+    Uniform<glm::vec3> boxExtentsUniform;
+    unsigned int cubeVAO = 0;
+    unsigned int cubeVBO = 0;
+    unsigned int cubeEBO = 0;
+
+    std::vector<Object> objects;
+    const Frustum *frustum = nullptr;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    unsigned int frame = 0;
+    unsigned int queriesIssued = 0;
+};
+
+#endif
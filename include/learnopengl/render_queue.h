@@ -0,0 +1,248 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frame_arena.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// State the draws of one object are issued with: program, face culling, the per-object uniforms and
+// the occlusion query they are conditional on (0 for none). Uniforms with location -1 are skipped.
+struct RenderState {
+    Shader *shader = nullptr;
+    bool cullFace = false;
+    Uniform<glm::mat4> modelUniform;
+    glm::mat4 model = glm::mat4(1.0f);
+    Uniform<float> shininessUniform;
+    float shininess = 0.0f;
+    Uniform<float> lodFadeUniform;
+    float lodFade = 0.0f;
+    GLuint conditionQuery = 0;
+    // lets a pass be executed one group at a time, such as one model at a time to time each
+    unsigned int group = 0;
+};
+
+// what executing the queue cost against issuing the same packets in submission order
+struct RenderQueueStats {
+    unsigned int packets = 0;
+    // program, face culling, object uniform, VAO and material changes of the executed order
+    unsigned int stateChanges = 0;
+    // the same count for the order the packets were added in
+    unsigned int unsortedStateChanges = 0;
+
+    unsigned int Saved() const
+    {
+        return unsortedStateChanges > stateChanges ? unsortedStateChanges - stateChanges : 0;
+    }
+};
+
+// Collects the mesh draws of a pass as packets, sorts them by a 64-bit key and executes them, issuing
+// only the state changes between consecutive packets. The key, most significant bits first:
+//   pass      4 bits   explicit ordering of groups of draws, lowest first
+//   shader    8 bits   slot of the program, in order of first use
+//   cull face 1 bit
+//   material 16 bits   MaterialLibrary row
+//   depth    24 bits   distance from the camera, front to back within a material
+// so program switches are the rarest and meshes sharing a material end up next to each other. The queue
+// is sorted once and then executed one pass at a time, so each pass can be profiled on its own.
+// States, packets and the commands of a run are per-frame data in the FrameArena, a queue is filled and
+// executed within one frame.
+class RenderQueue
+{
+public:
+    static const int PASS_BITS = 4;
+    static const int SHADER_BITS = 8;
+    static const int MATERIAL_BITS = 16;
+    static const int DEPTH_BITS = 24;
+    static const int PASS_SHIFT = SHADER_BITS + 1 + MATERIAL_BITS + DEPTH_BITS;
+
+    // empties the queue for a new pass seen from cameraPosition; depths beyond maxDepth share a key
+    void Clear(const glm::vec3 &cameraPosition, float maxDepth)
+    {
+        states.clear();
+        packets.clear();
+        camera = cameraPosition;
+        depthScale = maxDepth > 0.0f ? ((1u << DEPTH_BITS) - 1) / maxDepth : 0.0f;
+    }
+
+    // the state of the packets added next, returns its index for Add
+    unsigned int AddState(const RenderState &state)
+    {
+        states.push_back(state);
+        return states.size() - 1;
+    }
+
+    // queues a draw; position (world space) orders it by distance within its pass, shader and material
+    void Add(unsigned int pass, unsigned int state, const Mesh::DrawCommand &command, const glm::vec3 &position)
+    {
+        add(pass, state, command, (uint64_t) std::min(glm::length(position - camera) * depthScale, (float) ((1u << DEPTH_BITS) - 1)));
+    }
+
+    // queues a draw without a position, such as an instanced one spread over the scene; it goes first
+    // within its material
+    void Add(unsigned int pass, unsigned int state, const Mesh::DrawCommand &command)
+    {
+        add(pass, state, command, 0);
+    }
+
+    // orders the queued draws by key, or keeps the order they were added in when sort is false, and
+    // counts the state changes of both orders; call once before executing the passes
+    void Sort(bool sort = true)
+    {
+        stats.packets = packets.size();
+        stats.unsortedStateChanges = countStateChanges();
+        if (sort)
+            std::sort(packets.begin(), packets.end());
+        stats.stateChanges = countStateChanges();
+    }
+
+    // issues the queued draws of one pass in the order Sort left them, and leaves face culling off
+    void ExecutePass(unsigned int pass)
+    {
+        execute(pass, false, 0);
+    }
+
+    // the same for the draws of one group of the pass only
+    void ExecutePass(unsigned int pass, unsigned int group)
+    {
+        execute(pass, true, group);
+    }
+
+    const RenderQueueStats &Stats() const
+    {
+        return stats;
+    }
+
+private:
+    struct RenderPacket {
+        uint64_t key;
+        // order of submission, keeps the sort deterministic for equal keys
+        unsigned int sequence;
+        unsigned int state;
+        Mesh::DrawCommand command;
+
+        bool operator<(const RenderPacket &other) const
+        {
+            return key != other.key ? key < other.key : sequence < other.sequence;
+        }
+    };
+
+    FrameArray<RenderState> states;
+    FrameArray<RenderPacket> packets;
+    FrameArray<Mesh::DrawCommand> commands;
+    // programs in order of first use, their index is the shader field of the key
+    std::vector<const Shader*> shaders;
+    glm::vec3 camera = glm::vec3(0.0f);
+    float depthScale = 0.0f;
+    RenderQueueStats stats;
+
+    void execute(unsigned int pass, bool oneGroup, unsigned int group)
+    {
+        const RenderState *current = nullptr;
+        Mesh::SubmitState submitState;
+        for (const RenderPacket &packet: packets)
+        {
+            if (packet.key >> PASS_SHIFT != pass || (oneGroup && states[packet.state].group != group))
+                continue;
+            const RenderState *state = &states[packet.state];
+            if (state != current)
+            {
+                submitRun(current, submitState);
+                apply(current, *state, submitState);
+                current = state;
+            }
+            commands.push_back(packet.command);
+        }
+        submitRun(current, submitState);
+        if (current && current->conditionQuery)
+            glEndConditionalRender();
+        GLState::Get().SetEnabled(GL_CULL_FACE, false);
+    }
+
+    void add(unsigned int pass, unsigned int state, const Mesh::DrawCommand &command, uint64_t depth)
+    {
+        const RenderState &renderState = states[state];
+        uint64_t key = (uint64_t) std::min(pass, (1u << PASS_BITS) - 1);
+        key = key << SHADER_BITS | shaderSlot(renderState.shader);
+        key = key << 1 | (renderState.cullFace ? 1 : 0);
+        key = key << MATERIAL_BITS | std::min(command.mesh->MaterialIndex(), (1u << MATERIAL_BITS) - 1);
+        key = key << DEPTH_BITS | depth;
+        packets.push_back(RenderPacket{key, (unsigned int) packets.size(), state, command});
+    }
+
+    uint64_t shaderSlot(const Shader *shader)
+    {
+        size_t slot = std::find(shaders.begin(), shaders.end(), shader) - shaders.begin();
+        if (slot == shaders.size())
+            shaders.push_back(shader);
+        return std::min<uint64_t>(slot, (1u << SHADER_BITS) - 1);
+    }
+
+    // submits the collected run of packets sharing state, Submit filters VAO and material changes
+    void submitRun(const RenderState *state, Mesh::SubmitState &submitState)
+    {
+        if (!commands.empty())
+            Mesh::Submit(*state->shader, commands.data(), commands.size(), submitState);
+        commands.clear();
+    }
+
+    // switches from the state of the previous run (null at the start) to state
+    void apply(const RenderState *previous, const RenderState &state, Mesh::SubmitState &submitState)
+    {
+        if (!previous || previous->shader != state.shader)
+        {
+            state.shader->use();
+            // dequantization and material index are program uniforms
+            submitState.mesh = nullptr;
+        }
+        if (!previous || previous->cullFace != state.cullFace)
+            GLState::Get().SetEnabled(GL_CULL_FACE, state.cullFace);
+        if (state.modelUniform.location != -1)
+            state.modelUniform.set(state.model);
+        if (state.shininessUniform.location != -1)
+            state.shininessUniform.set(state.shininess);
+        if (state.lodFadeUniform.location != -1)
+            state.lodFadeUniform.set(state.lodFade);
+        if (!previous || previous->conditionQuery != state.conditionQuery)
+        {
+            if (previous && previous->conditionQuery)
+                glEndConditionalRender();
+            if (state.conditionQuery)
+                glBeginConditionalRender(state.conditionQuery, GL_QUERY_NO_WAIT);
+        }
+    }
+
+    // state changes executing the packets in their current order takes, see RenderQueueStats
+    unsigned int countStateChanges() const
+    {
+        unsigned int changes = 0;
+        const RenderState *state = nullptr;
+        const Mesh *mesh = nullptr;
+        for (const RenderPacket &packet: packets)
+        {
+            const RenderState &next = states[packet.state];
+            if (!state || next.shader != state->shader)
+                changes++;
+            if (!state || next.cullFace != state->cullFace)
+                changes++;
+            if (&next != state)
+                changes++;
+            if (!mesh || packet.command.mesh->VAO != mesh->VAO)
+                changes++;
+            if (!mesh || packet.command.mesh->MaterialIndex() != mesh->MaterialIndex())
+                changes++;
+            state = &next;
+            mesh = packet.command.mesh;
+        }
+        return changes;
+    }
+};
+
+#endif
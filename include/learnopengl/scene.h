@@ -0,0 +1,411 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/json.h>
+#include <learnopengl/lights.h>
+#include <learnopengl/transform_hierarchy.h>
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// a model the scene places, with how its copies are drawn
+struct SceneModel {
+    std::string name;
+    std::string path;
+    float shininess = 16.0f;
+    bool cullFace = false;
+    // the copies go out as instanced draws instead of one draw per copy
+    bool instanced = false;
+    // distant copies are drawn as billboards from a baked atlas, for instanced models
+    bool impostor = false;
+    // its batches, consecutive in Scene::batches
+    unsigned int firstBatch = 0;
+    unsigned int batchCount = 0;
+};
+
+// The placed copies of all models as a structure of arrays, sorted by model and then layer, so the
+// copies of one model in one layer are a contiguous range that is culled and instanced straight from
+// the table.
+struct SceneInstances {
+    // world matrices, copied from the transform hierarchy of the scene when they change
+    std::vector<glm::mat4> transforms;
+    std::vector<unsigned int> models;
+    std::vector<unsigned int> layers;
+    // node of each copy in Scene::transforms
+    std::vector<unsigned int> nodes;
+
+    size_t Size() const
+    {
+        return models.size();
+    }
+};
+
+// the copies of one model in one layer, a range of the instance table
+struct SceneBatch {
+    unsigned int model;
+    unsigned int layer;
+    unsigned int first;
+    unsigned int count;
+};
+
+struct SceneSkybox {
+    std::string name;
+    // +x, -x, +y, -y, +z, -z
+    std::vector<std::string> faces;
+};
+
+// Models, instances, lights and skyboxes of a scene, read from a JSON file:
+//   "models":    [{"name", "path", "shininess": 16, "cullFace": false, "instanced": false, "impostor": false}]
+//   "instances": [{"model", "name", "layer", "position": [x, y, z], "scale": s or [x, y, z],
+//                  "rotate": [{"angle": degrees, "axis": [x, y, z]}...], "spin": degrees per second,
+//                  "children": [{...}...]}]
+//   "scatter":   [{"model", "layer", "count", "seed", "center", "radius": [min, max], "scale": [min, max], "height"}]
+//   "lights":    {"directional": {...}, "spot": {...}, "point": [{...}...]}
+//   "skyboxes":  [{"name", "faces": [6 paths]}]
+// A copy is translated, scaled and then rotated by each rotation in order, relative to the instance it is
+// a child of; an entry without a model only places its children, which are in its layer unless they name
+// one. The transforms are nodes of a TransformHierarchy: a named one can be found with NodeIndex and moved
+// with transforms.SetLocal, and UpdateTransforms then refreshes the instance table. An entry with a spin turns
+// about its local y axis, carrying its children along, as Animate sets it for the time. Scatter places count copies
+// at random yaw and scale in a ring around center, the same ones for the same seed. Instances without a
+// layer are in layer 0, named layers get their index in layers in order of appearance and can be switched
+// off by the renderer. Light members are named like the struct fields, spot light angles are in degrees.
+class Scene
+{
+public:
+    std::vector<SceneModel> models;
+    // layer names, layer 0 is the unnamed default layer
+    std::vector<std::string> layers = {""};
+    SceneInstances instances;
+    std::vector<SceneBatch> batches;
+    DirLight dirLight = {};
+    SpotLight spotLight = {};
+    std::vector<PointLight> pointLights;
+    std::vector<SceneSkybox> skyboxes;
+    // local transforms of the instances and of the entries grouping them
+    TransformHierarchy transforms;
+
+    // replaces the scene with the one in filename; on failure returns false with a message in error
+    bool Load(const std::string &filename, std::string &error)
+    {
+        std::ifstream file(filename);
+        if (!file)
+        {
+            error = "cannot open " + filename;
+            return false;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        JsonValue document;
+        if (!JsonValue::Parse(text.str(), document, error))
+        {
+            error = filename + ", " + error;
+            return false;
+        }
+        *this = Scene();
+        if (!loadModels(document["models"], error) ||
+            !loadInstances(document["instances"], TransformHierarchy::NO_PARENT, 0, error) ||
+            !loadScatter(document["scatter"], error) || !loadLights(document["lights"], error) ||
+            !loadSkyboxes(document["skyboxes"], error))
+        {
+            error = filename + ": " + error;
+            return false;
+        }
+        transforms.Update();
+        sortInstances();
+        return true;
+    }
+
+    // turns the spinning entries to where they are at time seconds
+    void Animate(float time)
+    {
+        for (const Spin &spin: spins)
+            transforms.SetLocal(spin.node, glm::rotate(spin.local, glm::radians(spin.degreesPerSecond * time), glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    // copies the world matrices of the nodes moved since the last call into the instance table and
+    // returns how many were recomputed, nothing is done when nothing moved
+    size_t UpdateTransforms()
+    {
+        transforms.Update();
+        for (unsigned int node: transforms.Changed())
+            if (nodeRows[node] >= 0)
+                instances.transforms[nodeRows[node]] = transforms.World(node);
+        return transforms.Changed().size();
+    }
+
+    // index of the model or layer called name, -1 if there is none
+    int ModelIndex(const std::string &name) const
+    {
+        for (size_t i = 0; i < models.size(); i++)
+            if (models[i].name == name)
+                return i;
+        return -1;
+    }
+
+    int LayerIndex(const std::string &name) const
+    {
+        auto it = std::find(layers.begin(), layers.end(), name);
+        return it != layers.end() ? it - layers.begin() : -1;
+    }
+
+    // transform node of the instance entry called name, -1 if there is none
+    int NodeIndex(const std::string &name) const
+    {
+        if (name.empty())
+            return -1;
+        auto it = std::find(nodeNames.begin(), nodeNames.end(), name);
+        return it != nodeNames.end() ? it - nodeNames.begin() : -1;
+    }
+
+private:
+    // a node turning about its y axis, on top of the local transform its entry gave it
+    struct Spin {
+        unsigned int node;
+        glm::mat4 local;
+        float degreesPerSecond;
+    };
+
+    // indexed by node: the name of its entry, if any, and its row in the instance table, -1 for groups
+    std::vector<std::string> nodeNames;
+    std::vector<int> nodeRows;
+    std::vector<Spin> spins;
+
+    static glm::vec3 vec3(const JsonValue &value, const glm::vec3 &otherwise)
+    {
+        if (value.IsNumber())
+            return glm::vec3((float) value.Number());
+        if (!value.IsArray() || value.Size() != 3)
+            return otherwise;
+        return glm::vec3(value[0].Number(), value[1].Number(), value[2].Number());
+    }
+
+    unsigned int layerOf(const JsonValue &instance, unsigned int otherwise = 0)
+    {
+        if (!instance.Has("layer"))
+            return otherwise;
+        std::string name = instance["layer"].String("");
+        int layer = LayerIndex(name);
+        if (layer >= 0)
+            return layer;
+        layers.push_back(name);
+        return layers.size() - 1;
+    }
+
+    bool modelOf(const JsonValue &instance, unsigned int &model, std::string &error) const
+    {
+        int index = ModelIndex(instance["model"].String(""));
+        if (index < 0)
+        {
+            error = "instance of unknown model \"" + instance["model"].String("") + "\"";
+            return false;
+        }
+        model = index;
+        return true;
+    }
+
+    unsigned int addNode(const std::string &name, const glm::mat4 &local, int parent)
+    {
+        nodeNames.push_back(name);
+        return transforms.Add(local, parent);
+    }
+
+    void add(unsigned int model, unsigned int layer, unsigned int node)
+    {
+        instances.models.push_back(model);
+        instances.layers.push_back(layer);
+        instances.nodes.push_back(node);
+    }
+
+    bool loadModels(const JsonValue &list, std::string &error)
+    {
+        for (size_t i = 0; i < list.Size(); i++)
+        {
+            const JsonValue &entry = list[i];
+            SceneModel model;
+            model.name = entry["name"].String("");
+            model.path = entry["path"].String("");
+            if (model.name.empty() || model.path.empty() || ModelIndex(model.name) >= 0)
+            {
+                error = "model " + std::to_string(i) + " needs a unique name and a path";
+                return false;
+            }
+            model.shininess = entry["shininess"].Number(model.shininess);
+            model.cullFace = entry["cullFace"].Bool(model.cullFace);
+            model.instanced = entry["instanced"].Bool(model.instanced);
+            model.impostor = model.instanced && entry["impostor"].Bool(model.impostor);
+            models.push_back(model);
+        }
+        return true;
+    }
+
+    // entries of list and their children, below the node parent and by default in its layer
+    bool loadInstances(const JsonValue &list, int parent, unsigned int parentLayer, std::string &error)
+    {
+        for (size_t i = 0; i < list.Size(); i++)
+        {
+            const JsonValue &entry = list[i];
+            std::string name = entry["name"].String("");
+            if (NodeIndex(name) >= 0)
+            {
+                error = "instance name \"" + name + "\" is used twice";
+                return false;
+            }
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), vec3(entry["position"], glm::vec3(0.0f)));
+            transform = glm::scale(transform, vec3(entry["scale"], glm::vec3(1.0f)));
+            const JsonValue &rotations = entry["rotate"];
+            for (size_t r = 0; r < rotations.Size(); r++)
+            {
+                float angle = rotations[r]["angle"].Number();
+                if (angle != 0.0f)
+                    transform = glm::rotate(transform, glm::radians(angle), vec3(rotations[r]["axis"], glm::vec3(0.0f, 1.0f, 0.0f)));
+            }
+            unsigned int node = addNode(name, transform, parent);
+            float spin = entry["spin"].Number();
+            if (spin != 0.0f)
+                spins.push_back(Spin{node, transform, spin});
+            unsigned int layer = layerOf(entry, parentLayer);
+            if (entry.Has("model"))
+            {
+                unsigned int model;
+                if (!modelOf(entry, model, error))
+                    return false;
+                add(model, layer, node);
+            }
+            if (!loadInstances(entry["children"], node, layer, error))
+                return false;
+        }
+        return true;
+    }
+
+    bool loadScatter(const JsonValue &list, std::string &error)
+    {
+        for (size_t i = 0; i < list.Size(); i++)
+        {
+            const JsonValue &entry = list[i];
+            unsigned int model;
+            if (!modelOf(entry, model, error))
+                return false;
+            unsigned int layer = layerOf(entry);
+            glm::vec3 center = vec3(entry["center"], glm::vec3(0.0f));
+            std::mt19937 random((unsigned int) entry["seed"].Number());
+            std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+            std::uniform_real_distribution<float> radius(entry["radius"][0].Number(), entry["radius"][1].Number());
+            std::uniform_real_distribution<float> scale(entry["scale"][0].Number(1.0), entry["scale"][1].Number(1.0));
+            float height = entry["height"].Number();
+            for (int copy = 0; copy < (int) entry["count"].Number(); copy++)
+            {
+                float direction = glm::radians(angle(random));
+                float distance = radius(random);
+                float yaw = angle(random);
+                float size = scale(random);
+                glm::mat4 transform = glm::translate(glm::mat4(1.0f), center + glm::vec3(distance * glm::cos(direction), height, distance * glm::sin(direction)));
+                transform = glm::scale(transform, glm::vec3(size));
+                add(model, layer, addNode("", glm::rotate(transform, glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f)), TransformHierarchy::NO_PARENT));
+            }
+        }
+        return true;
+    }
+
+    bool loadLights(const JsonValue &lights, std::string &error)
+    {
+        const JsonValue &directional = lights["directional"];
+        dirLight.direction = glm::normalize(vec3(directional["direction"], glm::vec3(0.0f, -1.0f, 0.0f)));
+        dirLight.ambient = vec3(directional["ambient"], glm::vec3(0.0f));
+        dirLight.diffuse = vec3(directional["diffuse"], glm::vec3(0.0f));
+        dirLight.specular = vec3(directional["specular"], glm::vec3(0.0f));
+
+        const JsonValue &spot = lights["spot"];
+        spotLight.position = vec3(spot["position"], glm::vec3(0.0f));
+        spotLight.direction = vec3(spot["direction"], glm::vec3(0.0f, -1.0f, 0.0f));
+        spotLight.ambient = vec3(spot["ambient"], glm::vec3(0.0f));
+        spotLight.diffuse = vec3(spot["diffuse"], glm::vec3(0.0f));
+        spotLight.specular = vec3(spot["specular"], glm::vec3(0.0f));
+        spotLight.cutOff = glm::cos(glm::radians((float) spot["cutOff"].Number(12.0)));
+        spotLight.outerCutOff = glm::cos(glm::radians((float) spot["outerCutOff"].Number(15.0)));
+
+        const JsonValue &points = lights["point"];
+        for (size_t i = 0; i < points.Size(); i++)
+        {
+            const JsonValue &entry = points[i];
+            PointLight light = {};
+            light.position = vec3(entry["position"], glm::vec3(0.0f));
+            light.ambient = vec3(entry["ambient"], glm::vec3(0.0f));
+            light.diffuse = vec3(entry["diffuse"], glm::vec3(0.0f));
+            light.specular = vec3(entry["specular"], glm::vec3(0.0f));
+            light.constant = entry["constant"].Number(1.0);
+            light.linear = entry["linear"].Number();
+            light.quadratic = entry["quadratic"].Number();
+            pointLights.push_back(light);
+        }
+        return true;
+    }
+
+    bool loadSkyboxes(const JsonValue &list, std::string &error)
+    {
+        for (size_t i = 0; i < list.Size(); i++)
+        {
+            SceneSkybox skybox;
+            skybox.name = list[i]["name"].String("");
+            const JsonValue &faces = list[i]["faces"];
+            for (size_t face = 0; face < faces.Size(); face++)
+                skybox.faces.push_back(faces[face].String(""));
+            if (skybox.faces.size() != 6)
+            {
+                error = "skybox \"" + skybox.name + "\" needs 6 faces";
+                return false;
+            }
+            skyboxes.push_back(skybox);
+        }
+        return true;
+    }
+
+    // orders the table by model and layer, keeping the file order within a batch, fills in the world
+    // matrices and builds the batches
+    void sortInstances()
+    {
+        std::vector<size_t> order(instances.Size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            if (instances.models[a] != instances.models[b])
+                return instances.models[a] < instances.models[b];
+            return instances.layers[a] < instances.layers[b];
+        });
+        SceneInstances sorted;
+        nodeRows.assign(transforms.Size(), -1);
+        for (size_t index: order)
+        {
+            unsigned int node = instances.nodes[index];
+            nodeRows[node] = sorted.Size();
+            sorted.transforms.push_back(transforms.World(node));
+            sorted.models.push_back(instances.models[index]);
+            sorted.layers.push_back(instances.layers[index]);
+            sorted.nodes.push_back(node);
+        }
+        instances = sorted;
+
+        for (unsigned int i = 0; i < instances.Size(); i++)
+        {
+            if (batches.empty() || batches.back().model != instances.models[i] || batches.back().layer != instances.layers[i])
+                batches.push_back(SceneBatch{instances.models[i], instances.layers[i], i, 0});
+            batches.back().count++;
+        }
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            SceneModel &model = models[batches[i].model];
+            if (model.batchCount == 0)
+                model.firstBatch = i;
+            model.batchCount++;
+        }
+    }
+};
+
+#endif
@@ -4,15 +4,33 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 #include <common.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/uniform.h>
+
+// uniforms Mesh and MaterialLibrary set for every mesh they draw, resolved once at link time
+struct MeshUniformLocations
+{
+    GLint positionScale = -1;
+    GLint positionOffset = -1;
+    GLint texCoordTransform = -1;
+    Uniform<int> materialIndex;
+};
+
 class Shader
 {
 public:
     unsigned int ID;
+    MeshUniformLocations meshUniforms;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
@@ -96,6 +114,11 @@ public:
             glAttachShader(ID, geometry);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
+        meshUniforms.positionScale = getUniformLocation("positionScale");
+        meshUniforms.positionOffset = getUniformLocation("positionOffset");
+        meshUniforms.texCoordTransform = getUniformLocation("texCoordTransform");
+        meshUniforms.materialIndex = uniform<int>("materialIndex");
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -107,68 +130,192 @@ public:
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::Get().UseProgram(ID); 
+    }
+    // location of an active uniform from the table reflected at link time, -1 if the program has no such uniform.
+    // Looked up by C string, so setting a uniform by a literal name does not build a std::string.
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const char *name) const
+    {
+        auto it = std::lower_bound(uniformLocations.begin(), uniformLocations.end(), name,
+                                   [](const std::pair<std::string, GLint> &entry, const char *key) { return entry.first.compare(key) < 0; });
+        return it != uniformLocations.end() && it->first.compare(name) == 0 ? it->second : -1;
+    }
+    GLint getUniformLocation(const std::string &name) const
+    {
+        return getUniformLocation(name.c_str());
+    }
+    // typed handle for hot code, see Uniform
+    // ------------------------------------------------------------------------
+    template<typename T>
+    Uniform<T> uniform(const char *name) const
+    {
+        Uniform<T> handle;
+        handle.location = getUniformLocation(name);
+        return handle;
+    }
+    template<typename T>
+    Uniform<T> uniform(const std::string &name) const
+    {
+        return uniform<T>(name.c_str());
+    }
+    // attaches a uniform block to a buffer binding point, does nothing if the program doesn't use the block
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const std::string &blockName, GLuint bindingPoint) const
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(ID, blockName.c_str());
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, blockIndex, bindingPoint);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(const char *name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(const char *name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(const char *name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(const char *name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(getUniformLocation(name), 1, &value[0]); 
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(const char *name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(getUniformLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(const char *name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(getUniformLocation(name), 1, &value[0]); 
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(const char *name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(getUniformLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(const char *name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(getUniformLocation(name), 1, &value[0]); 
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
+    void setVec4(const char *name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(getUniformLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(const char *name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(const char *name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
+    void setMat4(const char *name, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // the same for names the caller already holds as a std::string, such as ones built in a loop; they
+    // look up by its characters and allocate nothing
+    // ------------------------------------------------------------------------
+    void setBool(const std::string &name, bool value) const
+    {
+        setBool(name.c_str(), value);
+    }
+    void setInt(const std::string &name, int value) const
+    {
+        setInt(name.c_str(), value);
+    }
+    void setFloat(const std::string &name, float value) const
+    {
+        setFloat(name.c_str(), value);
+    }
+    void setVec2(const std::string &name, const glm::vec2 &value) const
+    {
+        setVec2(name.c_str(), value);
+    }
+    void setVec2(const std::string &name, float x, float y) const
+    {
+        setVec2(name.c_str(), x, y);
+    }
+    void setVec3(const std::string &name, const glm::vec3 &value) const
+    {
+        setVec3(name.c_str(), value);
+    }
+    void setVec3(const std::string &name, float x, float y, float z) const
+    {
+        setVec3(name.c_str(), x, y, z);
+    }
+    void setVec4(const std::string &name, const glm::vec4 &value) const
+    {
+        setVec4(name.c_str(), value);
+    }
+    void setVec4(const std::string &name, float x, float y, float z, float w)
+    {
+        setVec4(name.c_str(), x, y, z, w);
+    }
+    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    {
+        setMat2(name.c_str(), mat);
+    }
+    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    {
+        setMat3(name.c_str(), mat);
+    }
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(name.c_str(), mat);
     }
 
 private:
+    // name -> location of every active uniform, sorted by name
+    std::vector<std::pair<std::string, GLint>> uniformLocations;
+
+    // builds the name -> location table of every active uniform. Arrays are reported once as "name[0]",
+    // so each element is registered under its own name as well as the bare array name.
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            if (location < 0)
+                continue; // members of uniform blocks have no location
+            uniformLocations.emplace_back(name, location);
+
+            const std::string arraySuffix = "[0]";
+            if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
+            {
+                std::string base = name.substr(0, name.size() - arraySuffix.size());
+                uniformLocations.emplace_back(base, location);
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniformLocations.emplace_back(elementName, glGetUniformLocation(ID, elementName.c_str()));
+                }
+            }
+        }
+        std::sort(uniformLocations.begin(), uniformLocations.end());
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,186 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#include <learnopengl/camera.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Fixed time step for everything that moves. Wall-clock time goes in with Advance, the update runs once
+// per Step in steps of exactly StepSeconds, and the frame is rendered Alpha of the way from the state
+// before the last step to the state after it. How the scene moves then depends only on the number of
+// steps, not on the frame rate; runs that advance one step per frame render the same frames everywhere.
+class SimulationClock
+{
+public:
+    explicit SimulationClock(double stepSeconds = 1.0 / 60.0, int maxStepsPerFrame = 8)
+            : stepSeconds(stepSeconds), maxStepsPerFrame(maxStepsPerFrame) {}
+
+    // adds elapsed wall-clock time; more than maxStepsPerFrame steps of it are dropped, so a long stall
+    // (loading, a breakpoint) is not caught up with a burst of updates
+    void Advance(double seconds)
+    {
+        accumulator = std::min(accumulator + std::max(seconds, 0.0), maxStepsPerFrame * stepSeconds);
+    }
+
+    // makes exactly steps steps due, independent of wall-clock time
+    void AdvanceSteps(int steps)
+    {
+        accumulator += steps * stepSeconds;
+    }
+
+    // consumes one due step, false when none is left for this frame
+    bool Step()
+    {
+        if (accumulator < stepSeconds)
+            return false;
+        accumulator -= stepSeconds;
+        steps++;
+        return true;
+    }
+
+    double StepSeconds() const
+    {
+        return stepSeconds;
+    }
+
+    // steps taken so far
+    uint64_t Steps() const
+    {
+        return steps;
+    }
+
+    // simulated time after the last step
+    double Time() const
+    {
+        return steps * stepSeconds;
+    }
+
+    // how far the frame is between the state before the last step (0) and after it (1)
+    float Alpha() const
+    {
+        return (float) (accumulator / stepSeconds);
+    }
+
+    // simulated time the frame shows, a step behind Time so both states it blends are known
+    double InterpolatedTime() const
+    {
+        return std::max(0.0, Time() - stepSeconds + accumulator);
+    }
+
+private:
+    double stepSeconds;
+    int maxStepsPerFrame;
+    double accumulator = 0.0;
+    uint64_t steps = 0;
+};
+
+// input consumed by one simulation step
+struct InputFrame {
+    enum Keys : uint8_t {
+        FORWARD_KEY = 1,
+        BACKWARD_KEY = 2,
+        LEFT_KEY = 4,
+        RIGHT_KEY = 8
+    };
+
+    // Keys held during the step
+    uint8_t keys = 0;
+    // mouse movement and scrolling since the previous step
+    float mouseX = 0.0f;
+    float mouseY = 0.0f;
+    float scroll = 0.0f;
+};
+
+// The input of every simulation step of a session and the camera state it started from. Recorded and
+// saved as text, a "camera x y z yaw pitch zoom walking" line followed by one "keys mouseX mouseY scroll"
+// step per line, and fed back step by step from the same camera state to replay the session exactly.
+class InputLog
+{
+public:
+    void SetStart(const CameraState &state)
+    {
+        start = state;
+        hasStart = true;
+    }
+
+    // false for logs written without a camera line
+    bool HasStart() const
+    {
+        return hasStart;
+    }
+
+    const CameraState &Start() const
+    {
+        return start;
+    }
+
+    void Add(const InputFrame &input)
+    {
+        frames.push_back(input);
+    }
+
+    // input of step (counted from 0), no input past the end
+    InputFrame At(uint64_t step) const
+    {
+        return step < frames.size() ? frames[step] : InputFrame();
+    }
+
+    size_t Size() const
+    {
+        return frames.size();
+    }
+
+    // replaces the steps with the ones in a file written by Save, false if it cannot be read
+    bool Load(const std::string &filename)
+    {
+        std::ifstream in(filename);
+        if (!in)
+            return false;
+        frames.clear();
+        hasStart = false;
+        std::string word;
+        std::streampos begin = in.tellg();
+        if (in >> word && word == "camera")
+        {
+            in >> start.Position.x >> start.Position.y >> start.Position.z >> start.Yaw >> start.Pitch
+               >> start.Zoom >> start.TimeSpentWalking;
+            hasStart = !in.fail();
+        }
+        else
+        {
+            in.clear();
+            in.seekg(begin);
+        }
+        unsigned int keys;
+        InputFrame input;
+        while (in >> keys >> input.mouseX >> input.mouseY >> input.scroll)
+        {
+            input.keys = (uint8_t) keys;
+            frames.push_back(input);
+        }
+        return true;
+    }
+
+    void Save(const std::string &filename) const
+    {
+        std::ofstream out(filename);
+        // enough digits that the floats read back bit for bit
+        out.precision(9);
+        if (hasStart)
+            out << "camera " << start.Position.x << ' ' << start.Position.y << ' ' << start.Position.z << ' '
+                << start.Yaw << ' ' << start.Pitch << ' ' << start.Zoom << ' ' << start.TimeSpentWalking << '\n';
+        for (const InputFrame &input: frames)
+            out << (unsigned int) input.keys << ' ' << input.mouseX << ' ' << input.mouseY << ' ' << input.scroll << '\n';
+    }
+
+private:
+    std::vector<InputFrame> frames;
+    CameraState start = {};
+    bool hasStart = false;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Local transforms of a tree of nodes and their cached world matrices, as parallel arrays. A node can
+// only be parented to a node added before it, so parents always come first and one pass in index order
+// sees the world matrix of every parent before those of its children. Setting a local transform marks
+// the node dirty and Update recomputes the dirty nodes and everything below them in one contiguous
+// loop; when nothing moved it returns right away, so static nodes cost nothing per frame.
+class TransformHierarchy
+{
+public:
+    static const int NO_PARENT = -1;
+
+    // adds a node below parent, or a root, and returns its index
+    unsigned int Add(const glm::mat4 &local, int parent = NO_PARENT)
+    {
+        unsigned int node = locals.size();
+        if (parent < 0 || (unsigned int) parent >= node)
+            parent = NO_PARENT;
+        locals.push_back(local);
+        worlds.push_back(local);
+        parents.push_back(parent);
+        dirty.push_back(1);
+        firstDirty = std::min(firstDirty, (size_t) node);
+        return node;
+    }
+
+    void SetLocal(unsigned int node, const glm::mat4 &local)
+    {
+        locals[node] = local;
+        dirty[node] = 1;
+        firstDirty = std::min(firstDirty, (size_t) node);
+    }
+
+    const glm::mat4 &Local(unsigned int node) const
+    {
+        return locals[node];
+    }
+
+    // world matrix as of the last Update
+    const glm::mat4 &World(unsigned int node) const
+    {
+        return worlds[node];
+    }
+
+    int Parent(unsigned int node) const
+    {
+        return parents[node];
+    }
+
+    size_t Size() const
+    {
+        return locals.size();
+    }
+
+    // Recomputes the world matrices of the dirty nodes and their descendants, and lists those nodes in
+    // Changed. Nodes before the first dirty one cannot be affected and are not visited.
+    size_t Update()
+    {
+        changed.clear();
+        if (firstDirty >= locals.size())
+            return 0;
+        for (size_t node = firstDirty; node < locals.size(); node++)
+        {
+            int parent = parents[node];
+            if (!dirty[node] && (parent == NO_PARENT || !dirty[parent]))
+                continue;
+            // stays marked until the pass is over, so the children see it
+            dirty[node] = 1;
+            worlds[node] = parent == NO_PARENT ? locals[node] : worlds[parent] * locals[node];
+            changed.push_back(node);
+        }
+        for (unsigned int node: changed)
+            dirty[node] = 0;
+        firstDirty = locals.size();
+        return changed.size();
+    }
+
+    // the nodes whose world matrix the last Update recomputed, in index order
+    const std::vector<unsigned int> &Changed() const
+    {
+        return changed;
+    }
+
+private:
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<int> parents;
+    std::vector<unsigned char> dirty;
+    std::vector<unsigned int> changed;
+    // lowest dirty node, Size() when none is
+    size_t firstDirty = 0;
+};
+
+#endif
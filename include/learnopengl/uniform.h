@@ -0,0 +1,31 @@
+#ifndef UNIFORM_H
+#define UNIFORM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// glUniform* overloads used by the typed uniform handles
+inline void setUniformValue(GLint location, bool value) { glUniform1i(location, (int)value); }
+inline void setUniformValue(GLint location, int value) { glUniform1i(location, value); }
+inline void setUniformValue(GLint location, float value) { glUniform1f(location, value); }
+inline void setUniformValue(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::mat2 &mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniformValue(GLint location, const glm::mat3 &mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniformValue(GLint location, const glm::mat4 &mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+
+// pre-resolved uniform location of a known type, resolve once with Shader::uniform<T>(name) and keep it
+// around in hot code. Like the set* functions it writes to the currently bound program.
+template<typename T>
+struct Uniform
+{
+    GLint location = -1;
+
+    void set(const T &value) const
+    {
+        setUniformValue(location, value);
+    }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// binding points of the uniform blocks shared by all scene shaders, see Shader::bindUniformBlock
+enum UniformBlockBinding {
+    CAMERA_BLOCK_BINDING = 0,
+    LIGHTS_BLOCK_BINDING = 1
+};
+
+// std140 mirror of
+//   layout (std140) uniform Camera { mat4 projection; mat4 view; vec3 viewPosition; };
+struct CameraBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float     padding0;
+};
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock does not match the std140 Camera block");
+static_assert(offsetof(CameraBlock, viewPosition) == 128, "CameraBlock does not match the std140 Camera block");
+
+// Uniform buffer holding one std140 block of type T. The buffer is attached to its binding point once on
+// creation, every program that has the block bound to the same point reads from it, so a frame only
+// needs a single Upload no matter how many shaders use the block.
+template<typename T>
+class UniformBuffer
+{
+public:
+    unsigned int ID = 0;
+
+    explicit UniformBuffer(GLuint bindingPoint)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+    }
+
+    ~UniformBuffer()
+    {
+        glDeleteBuffers(1, &ID);
+    }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    void Upload(const T &data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+#endif
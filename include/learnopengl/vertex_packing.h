@@ -0,0 +1,147 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <learnopengl/bounds.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+// Compact GPU layout of a Vertex, 20 instead of 56 bytes:
+//   Position   3 x unorm16 + pad   quantized to the mesh bounding box
+//   Normal     snorm 10:10:10:2
+//   TexCoords  2 x unorm16         quantized to the mesh texture coordinate range
+//   Tangent    snorm 10:10:10:2    w is the bitangent sign, the bitangent is cross(normal, tangent) * w
+// Vertex shaders undo the quantization with the uniforms set by SetDequantization, which are the identity
+// for meshes that keep the float layout.
+struct PackedVertex {
+    uint16_t Position[4];
+    uint32_t Normal;
+    uint16_t TexCoords[2];
+    uint32_t Tangent;
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// model space = quantized * scale + offset, for positions and texture coordinates
+struct VertexQuantization {
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec2 texCoordScale = glm::vec2(1.0f);
+    glm::vec2 texCoordOffset = glm::vec2(0.0f);
+
+    // texture coordinate range over which 16 bits still resolve a fraction of a texel of a 2k texture
+    static constexpr float MAX_TEXCOORD_RANGE = 16.0f;
+
+    // quantization covering the vertices; packed is false if their texture coordinates span too many
+    // repeats for 16 bits, the mesh then keeps the float layout. Positions are quantized against
+    // positionBounds when given, which must contain them: the meshes of one model share its box, so
+    // vertices on the seam between two meshes round to the same position and no cracks open.
+    static VertexQuantization Fit(const std::vector<Vertex> &vertices, bool &packed, const AABB *positionBounds = nullptr)
+    {
+        VertexQuantization quantization;
+        packed = !vertices.empty();
+        if (!packed)
+            return quantization;
+        AABB positions;
+        glm::vec2 texCoordMin = vertices[0].TexCoords;
+        glm::vec2 texCoordMax = vertices[0].TexCoords;
+        for (const Vertex &vertex: vertices) {
+            positions.Expand(vertex.Position);
+            texCoordMin = glm::min(texCoordMin, vertex.TexCoords);
+            texCoordMax = glm::max(texCoordMax, vertex.TexCoords);
+        }
+        glm::vec2 texCoordRange = texCoordMax - texCoordMin;
+        if (!std::isfinite(texCoordRange.x) || !std::isfinite(texCoordRange.y) ||
+            texCoordRange.x > MAX_TEXCOORD_RANGE || texCoordRange.y > MAX_TEXCOORD_RANGE) {
+            packed = false;
+            return quantization;
+        }
+        if (positionBounds && !positionBounds->IsEmpty())
+            positions = *positionBounds;
+        quantization.positionOffset = positions.min;
+        quantization.positionScale = positions.max - positions.min;
+        quantization.texCoordOffset = texCoordMin;
+        quantization.texCoordScale = texCoordRange;
+        return quantization;
+    }
+
+    PackedVertex Pack(const Vertex &vertex) const
+    {
+        PackedVertex packed;
+        glm::vec3 position = quantize(vertex.Position - positionOffset, positionScale);
+        glm::vec3 texCoords = quantize(glm::vec3(vertex.TexCoords - texCoordOffset, 0.0f), glm::vec3(texCoordScale, 0.0f));
+        for (int i = 0; i < 3; i++)
+            packed.Position[i] = (uint16_t) std::lround(position[i] * 65535.0f);
+        packed.Position[3] = 0;
+        packed.TexCoords[0] = (uint16_t) std::lround(texCoords.x * 65535.0f);
+        packed.TexCoords[1] = (uint16_t) std::lround(texCoords.y * 65535.0f);
+
+        // orthonormal tangent frame, the handedness of the bitangent survives as a sign
+        glm::vec3 normal = safeNormalize(vertex.Normal, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::vec3 tangent = vertex.Tangent - normal * glm::dot(normal, vertex.Tangent);
+        glm::vec3 fallback = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        tangent = safeNormalize(tangent, glm::normalize(glm::cross(fallback, normal)));
+        float handedness = glm::dot(glm::cross(normal, tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed.Normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+        packed.Tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+        return packed;
+    }
+
+    // sets the dequantization uniforms of the vertex shaders drawing the mesh
+    void SetDequantization(GLint positionScaleLocation, GLint positionOffsetLocation, GLint texCoordTransformLocation) const
+    {
+        glUniform3fv(positionScaleLocation, 1, &positionScale[0]);
+        glUniform3fv(positionOffsetLocation, 1, &positionOffset[0]);
+        glUniform4f(texCoordTransformLocation, texCoordScale.x, texCoordScale.y, texCoordOffset.x, texCoordOffset.y);
+    }
+
+    // attribute pointers of a VAO sourcing PackedVertex from the bound GL_ARRAY_BUFFER
+    static void SetupPackedAttributes()
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+    }
+
+private:
+    // value / range in [0, 1], 0 on axes where the range is empty
+    static glm::vec3 quantize(const glm::vec3 &value, const glm::vec3 &range)
+    {
+        glm::vec3 result(0.0f);
+        for (int i = 0; i < 3; i++)
+            if (range[i] > 0.0f)
+                result[i] = glm::clamp(value[i] / range[i], 0.0f, 1.0f);
+        return result;
+    }
+
+    static glm::vec3 safeNormalize(const glm::vec3 &vector, const glm::vec3 &fallback)
+    {
+        float length = glm::length(vector);
+        return length > 1e-8f ? vector / length : fallback;
+    }
+};
+
+#endif
@@ -13,8 +13,43 @@
 #include <rg/Error.h>
 #include <common.h>
 #include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <learnopengl/uniform.h>
+
 class Shader {
     unsigned int m_Id;
+    std::unordered_map<std::string, GLint> m_UniformLocations;
+
+    // name -> location of every active uniform, array elements are registered individually
+    void reflectUniforms() {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(m_Id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(m_Id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(maxLength + 1);
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(m_Id, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            GLint location = glGetUniformLocation(m_Id, name.c_str());
+            if (location < 0) {
+                continue;
+            }
+            m_UniformLocations[name] = location;
+
+            const std::string arraySuffix = "[0]";
+            if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0) {
+                std::string base = name.substr(0, name.size() - arraySuffix.size());
+                m_UniformLocations[base] = location;
+                for (GLint element = 1; element < size; ++element) {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    m_UniformLocations[elementName] = glGetUniformLocation(m_Id, elementName.c_str());
+                }
+            }
+        }
+    }
 public:
     Shader(std::string vertexShaderPath, std::string fragmentShaderPath) {
         appendShaderFolderIfNotPresent(vertexShaderPath);
@@ -65,6 +100,7 @@ public:
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
         m_Id = shaderProgram;
+        reflectUniforms();
     }
 
     // activate the shader
@@ -73,67 +109,80 @@ public:
     {
         glUseProgram(m_Id);
     }
+
+    GLint getUniformLocation(const std::string &name) const {
+        auto it = m_UniformLocations.find(name);
+        return it != m_UniformLocations.end() ? it->second : -1;
+    }
+
+    template<typename T>
+    Uniform<T> uniform(const std::string &name) const {
+        Uniform<T> handle;
+        handle.location = getUniformLocation(name);
+        return handle;
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(m_Id, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(m_Id, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(m_Id, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(m_Id, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(m_Id, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(m_Id, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     void deleteProgram() {
         glDeleteProgram(m_Id);
         m_Id = 0;
+        m_UniformLocations.clear();
     }
 
 
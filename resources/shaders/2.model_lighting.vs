@@ -6,15 +6,30 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
+// level of detail cross-fade, see Model::Draw
+flat out float LodFade;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform float lodFade;
+// vertex dequantization, see include/learnopengl/vertex_packing.h
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform vec4 texCoordTransform;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// the depth pre-pass reuses this shader, its depth has to match the main pass exactly for GL_EQUAL
+invariant gl_Position;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  ;
-    TexCoords = aTexCoords;    
+    vec3 position = aPos * positionScale + positionOffset;
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoords = aTexCoords * texCoordTransform.xy + texCoordTransform.zw;
+    LodFade = lodFade;
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
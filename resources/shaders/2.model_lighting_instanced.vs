@@ -0,0 +1,38 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceModel;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+// level of detail cross-fade, see Model::DrawInstanced
+flat out float LodFade;
+
+// vertex dequantization, see include/learnopengl/vertex_packing.h
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform vec4 texCoordTransform;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// the depth pre-pass reuses this shader, its depth has to match the main pass exactly for GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+    // the cross-fade rides in the [0][3] element, zero in an affine model matrix
+    mat4 model = aInstanceModel;
+    LodFade = model[0][3];
+    model[0][3] = 0.0;
+    vec3 position = aPos * positionScale + positionOffset;
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoords = aTexCoords * texCoordTransform.xy + texCoordTransform.zw;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#version 330 core
+out vec4 FragColor;
+
+// light structs mirror include/learnopengl/lights.h, point lights are fetched from pointLightData
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+    float radius;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+
+
+struct SpotLight {
+    vec3 position;
+    float cutOff;
+    vec3 direction;
+    float outerCutOff;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct ClusterGrid {
+    ivec4 size;
+    vec4 params;
+};
+
+
+
+// surface attributes of the current pixel, read from the G-buffer
+vec3 albedo;
+vec3 specularColor;
+float shininess;
+
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    ClusterGrid clusters;
+};
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+// clustered point lights, see include/learnopengl/clustered_lighting.h
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer lightIndexData;
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // fade out towards the culling radius so lights don't pop at cluster borders
+    float window = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
+    // combine results
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularColor.xxx;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
+
+PointLight FetchPointLight(int index)
+{
+    vec4 t0 = texelFetch(pointLightData, 4 * index);
+    vec4 t1 = texelFetch(pointLightData, 4 * index + 1);
+    vec4 t2 = texelFetch(pointLightData, 4 * index + 2);
+    vec4 t3 = texelFetch(pointLightData, 4 * index + 3);
+    PointLight light;
+    light.position = t0.xyz;
+    light.constant = t0.w;
+    light.ambient = t1.xyz;
+    light.linear = t1.w;
+    light.diffuse = t2.xyz;
+    light.quadratic = t2.w;
+    light.specular = t3.xyz;
+    light.radius = t3.w;
+    return light;
+}
+
+// index of the cluster a fragment falls into, matches ClusteredLighting on the CPU side
+int ClusterIndex(vec3 fragPos)
+{
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusters.params.xy), clusters.size.xy - 1);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = clamp(int(floor(log(depth) * clusters.params.z + clusters.params.w)), 0, clusters.size.z - 1);
+    return (slice * clusters.size.y + tile.y) * clusters.size.x + tile.x;
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-dirLight.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    vec3 ambient  = light.ambient  * albedo;
+    vec3 diffuse  = light.diffuse  * diff * albedo;
+    vec3 specular = light.specular * spec * specularColor;
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    // spotlight intensity
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    // combine results
+    vec3 ambient  = intensity * light.ambient  * albedo;
+    vec3 diffuse  = intensity * light.diffuse * diff * albedo;
+    vec3 specular = intensity * light.specular * spec * specularColor;
+
+    return (ambient + diffuse + specular);
+}
+
+// lighting pass of the deferred renderer, shades every covered pixel once with the lights of 2.model_lighting.fs
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    // nothing was drawn here, leave the clear color
+    if(depth == 1.0)
+            discard;
+
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec4 worldPos = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 FragPos = worldPos.xyz / worldPos.w;
+
+    albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+    specularColor = specular.rgb;
+    shininess = specular.a * 256.0;
+
+    vec3 normal = texelFetch(gNormal, pixel, 0).xyz;
+    vec3 viewDir = normalize(viewPosition - FragPos);
+    vec3 result = CalcDirLight(dirLight, normal, viewDir);
+    uvec2 cluster = texelFetch(clusterData, ClusterIndex(FragPos)).rg;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int lightIndex = int(texelFetch(lightIndexData, int(cluster.x + i)).r);
+        result += CalcPointLight(FetchPointLight(lightIndex), normal, FragPos, viewDir);
+    }
+    result += CalcSpotLight(spotLight, normal, FragPos, viewDir);
+    FragColor = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 330 core
+
+// depth pre-pass for opaque surfaces, nothing to do beyond the fixed function depth write
+void main()
+{
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#version 330 core
+
+struct Material {
+    sampler2DArray texture_diffuse1;
+};
+
+in vec2 TexCoords;
+flat in float LodFade;
+
+uniform Material material;
+
+// layers of the material's textures in the texture arrays, one RGBA32UI row per material, see MaterialLibrary
+uniform usamplerBuffer materialData;
+uniform int materialIndex;
+
+vec3 MaterialCoords(vec2 texCoords, int slot)
+{
+    return vec3(texCoords, float(texelFetch(materialData, materialIndex)[slot]));
+}
+
+// screen-door cross-fade between two levels of detail: a positive fade keeps that fraction of the
+// pixels, a negative one the complementary pattern, see Model::Draw
+bool LodDitherDiscard()
+{
+    if (LodFade == 0.0)
+        return false;
+    float dither = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    return LodFade > 0.0 ? dither >= LodFade : dither < 1.0 + LodFade;
+}
+
+// depth pre-pass, only the alpha test and dither of 2.model_lighting.fs so cut-out foliage leaves the right depth
+void main()
+{
+    if (LodDitherDiscard())
+        discard;
+    if(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)).a < 0.1)
+            discard;
+}
\ No newline at end of file
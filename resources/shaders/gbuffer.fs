@@ -0,0 +1,51 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gSpecular;
+
+struct Material {
+    sampler2DArray texture_diffuse1;
+    sampler2DArray texture_specular1;
+
+    float shininess;
+};
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+flat in float LodFade;
+
+uniform Material material;
+
+// layers of the material's textures in the texture arrays, one RGBA32UI row per material, see MaterialLibrary
+uniform usamplerBuffer materialData;
+uniform int materialIndex;
+
+vec3 MaterialCoords(vec2 texCoords, int slot)
+{
+    return vec3(texCoords, float(texelFetch(materialData, materialIndex)[slot]));
+}
+
+// screen-door cross-fade between two levels of detail: a positive fade keeps that fraction of the
+// pixels, a negative one the complementary pattern, see Model::Draw
+bool LodDitherDiscard()
+{
+    if (LodFade == 0.0)
+        return false;
+    float dither = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    return LodFade > 0.0 ? dither >= LodFade : dither < 1.0 + LodFade;
+}
+
+// geometry pass of the deferred renderer, writes the surface attributes 2.model_lighting.fs would shade with
+void main()
+{
+    if (LodDitherDiscard())
+        discard;
+    vec4 texColor = texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0));
+    if(texColor.a < 0.1)
+            discard;
+    gAlbedo = vec4(texColor.rgb, 1.0);
+    gNormal = vec4(normalize(Normal), 0.0);
+    // shininess is stored scaled down to fit the 8 bit channel
+    gSpecular = vec4(texture(material.texture_specular1, MaterialCoords(TexCoords, 1)).rgb, material.shininess / 256.0);
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gSpecular;
+
+struct Material {
+    sampler2DArray texture_diffuse1;
+    sampler2DArray texture_specular1;
+    sampler2DArray texture_normal;
+    float shininess;
+};
+
+in vec2 texCoords;
+in vec3 FragPos;
+in mat3 TBN;
+in mat3 TBNP;//inverse
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+uniform Material material;
+
+// layers of the material's textures in the texture arrays, one RGBA32UI row per material, see MaterialLibrary
+uniform usamplerBuffer materialData;
+uniform int materialIndex;
+
+vec3 MaterialCoords(vec2 texCoords, int slot)
+{
+    return vec3(texCoords, float(texelFetch(materialData, materialIndex)[slot]));
+}
+uniform float height_scale;
+uniform bool parallaxMappingToggle;
+
+vec2 ParallaxMapping(vec2 texCoords, vec3 lViewDir){
+    const float minLayers = 8;
+    const float maxLayers = 32;
+    float numLayers = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), lViewDir)));
+
+    float layerDepth = 1.0 / numLayers;
+
+    float currentLayerDepth = 0.0;
+
+    vec2 P = lViewDir.xy / lViewDir.z * height_scale;
+    vec2 deltaTexCoords = P / numLayers;
+
+    vec2 currentTexCoords = texCoords;
+    //loaded the displacement map as the specular texture, used for both because it looks similar
+    //1 - height because its not an inverse displacement map
+    float currentDepthMapValue = 1 - texture(material.texture_specular1, MaterialCoords(currentTexCoords, 1)).r;
+
+    while(currentLayerDepth < currentDepthMapValue)
+    {
+        currentTexCoords -= deltaTexCoords;
+        currentDepthMapValue = 1 - texture(material.texture_specular1, MaterialCoords(currentTexCoords, 1)).r; // 1 - here too
+        currentLayerDepth += layerDepth;
+    }
+
+    return currentTexCoords;
+}
+
+// geometry pass of the deferred renderer for the normal/parallax mapped walls, see normal.fs
+void main()
+{
+    vec3 viewDir = normalize(viewPosition - FragPos);
+    vec3 viewDirTangentSpace = normalize(TBNP * viewDir);
+    vec2 TexCoords;
+    if(parallaxMappingToggle) {
+        TexCoords = ParallaxMapping(texCoords,  viewDirTangentSpace);
+    } else {
+        TexCoords = texCoords;
+    }
+
+    vec3 normal = texture(material.texture_normal, MaterialCoords(TexCoords, 2)).rgb;
+    normal = normal * 2.0 - 1.0;
+    normal = normalize(TBN * normal);
+
+    vec4 texColor = texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0));
+    if(texColor.a < 0.1)
+            discard;
+    gAlbedo = vec4(texColor.rgb, 1.0);
+    gNormal = vec4(normal, 0.0);
+    // shininess is stored scaled down to fit the 8 bit channel
+    gSpecular = vec4(texture(material.texture_specular1, MaterialCoords(TexCoords, 1)).rgb, material.shininess / 256.0);
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+#version 330 core
+out vec4 FragColor;
+
+// light structs mirror include/learnopengl/lights.h, point lights are fetched from pointLightData
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+    float radius;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+
+
+struct Material {
+    float shininess;
+};
+
+struct SpotLight {
+    vec3 position;
+    float cutOff;
+    vec3 direction;
+    float outerCutOff;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct ClusterGrid {
+    ivec4 size;
+    vec4 params;
+};
+
+
+
+in vec2 TexCoords;
+in vec3 FragPos;
+flat in mat3 NormalMatrix;
+flat in vec3 FrameOffset;
+
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    ClusterGrid clusters;
+};
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+uniform Material material;
+
+// impostor atlas, see include/learnopengl/impostor.h
+uniform sampler2D impostorAlbedo;
+uniform sampler2D impostorNormalDepth;
+
+// surface of the current fragment, read from the atlas in main
+vec3 surfaceAlbedo;
+vec3 surfaceSpecular;
+
+// clustered point lights, see include/learnopengl/clustered_lighting.h
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer lightIndexData;
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // fade out towards the culling radius so lights don't pop at cluster borders
+    float window = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
+    // combine results
+    vec3 ambient = light.ambient * surfaceAlbedo;
+    vec3 diffuse = light.diffuse * diff * surfaceAlbedo;
+    vec3 specular = light.specular * spec * surfaceSpecular;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
+
+PointLight FetchPointLight(int index)
+{
+    vec4 t0 = texelFetch(pointLightData, 4 * index);
+    vec4 t1 = texelFetch(pointLightData, 4 * index + 1);
+    vec4 t2 = texelFetch(pointLightData, 4 * index + 2);
+    vec4 t3 = texelFetch(pointLightData, 4 * index + 3);
+    PointLight light;
+    light.position = t0.xyz;
+    light.constant = t0.w;
+    light.ambient = t1.xyz;
+    light.linear = t1.w;
+    light.diffuse = t2.xyz;
+    light.quadratic = t2.w;
+    light.specular = t3.xyz;
+    light.radius = t3.w;
+    return light;
+}
+
+// index of the cluster a fragment falls into, matches ClusteredLighting on the CPU side
+int ClusterIndex(vec3 fragPos)
+{
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusters.params.xy), clusters.size.xy - 1);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = clamp(int(floor(log(depth) * clusters.params.z + clusters.params.w)), 0, clusters.size.z - 1);
+    return (slice * clusters.size.y + tile.y) * clusters.size.x + tile.x;
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-dirLight.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
+    vec3 ambient  = light.ambient  * surfaceAlbedo;
+    vec3 diffuse  = light.diffuse  * diff * surfaceAlbedo;
+    vec3 specular = light.specular * spec * surfaceSpecular;
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
+    // spotlight intensity
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    // combine results
+    vec3 ambient  = intensity * light.ambient  * surfaceAlbedo;
+    vec3 diffuse  = intensity * light.diffuse * diff * surfaceAlbedo;
+    vec3 specular = intensity * light.specular * spec * surfaceSpecular;
+
+    return (ambient + diffuse + specular);
+}
+
+// lit impostor: albedo, normal and depth come from the atlas frame facing the camera, the depth moves
+// the fragment off the billboard plane so lights see the baked surface
+void main()
+{
+    vec4 albedo = texture(impostorAlbedo, TexCoords);
+    if(albedo.a < 0.5)
+            discard;
+    vec4 normalDepth = texture(impostorNormalDepth, TexCoords);
+    surfaceAlbedo = albedo.rgb;
+    surfaceSpecular = vec3(0.05);
+    vec3 normal = normalize(NormalMatrix * (normalDepth.xyz * 2.0 - 1.0));
+    vec3 fragPos = FragPos + FrameOffset * (normalDepth.a * 2.0 - 1.0);
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    vec3 result = CalcDirLight(dirLight, normal, viewDir);
+    uvec2 cluster = texelFetch(clusterData, ClusterIndex(fragPos)).rg;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int lightIndex = int(texelFetch(lightIndexData, int(cluster.x + i)).r);
+        result += CalcPointLight(FetchPointLight(lightIndex), normal, fragPos, viewDir);
+    }
+    result += CalcSpotLight(spotLight, normal, fragPos, viewDir);
+    FragColor = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+layout (location = 5) in mat4 aInstanceModel;
+
+out vec2 TexCoords;
+out vec3 FragPos;
+// model to world transform of the baked normals, and the world space offset from the billboard plane
+// to the front of the bounding sphere along the frame direction
+flat out mat3 NormalMatrix;
+flat out vec3 FrameOffset;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+// model space bounding sphere (center, radius) the atlas frames were rendered around
+uniform vec4 impostorSphere;
+// frames per side of the hemi-octahedral atlas
+uniform int impostorFrames;
+
+// the depth pre-pass reuses this shader, its depth has to match the main pass exactly for GL_EQUAL
+invariant gl_Position;
+
+// upper hemisphere directions to [-1, 1]^2 and back, must match include/learnopengl/impostor.h
+vec2 HemiOctEncode(vec3 direction)
+{
+    vec2 p = direction.xz / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    return vec2(p.x + p.y, p.x - p.y);
+}
+
+vec3 HemiOctDecode(vec2 p)
+{
+    vec2 t = vec2(p.x + p.y, p.x - p.y) * 0.5;
+    return normalize(vec3(t.x, 1.0 - abs(t.x) - abs(t.y), t.y));
+}
+
+void main()
+{
+    // the frame whose bake direction is closest to the direction towards the camera, in model space
+    vec3 center = vec3(aInstanceModel * vec4(impostorSphere.xyz, 1.0));
+    vec3 toCamera = inverse(mat3(aInstanceModel)) * (viewPosition - center);
+    toCamera.y = max(toCamera.y, 0.0);
+    float frames = float(impostorFrames);
+    vec2 frame = clamp(floor((HemiOctEncode(normalize(toCamera + vec3(0.0, 1e-4, 0.0))) * 0.5 + 0.5) * frames), 0.0, frames - 1.0);
+    vec3 direction = HemiOctDecode((frame + 0.5) / frames * 2.0 - 1.0);
+
+    // billboard in the plane the frame was rendered in
+    vec3 right = abs(direction.y) > 0.999 ? vec3(1.0, 0.0, 0.0) : normalize(cross(vec3(0.0, 1.0, 0.0), direction));
+    vec3 up = cross(direction, right);
+    vec3 corner = impostorSphere.xyz + (right * aCorner.x + up * aCorner.y) * impostorSphere.w;
+
+    FragPos = vec3(aInstanceModel * vec4(corner, 1.0));
+    TexCoords = (frame + aCorner * 0.5 + 0.5) / frames;
+    NormalMatrix = mat3(transpose(inverse(aInstanceModel)));
+    FrameOffset = mat3(aInstanceModel) * direction * impostorSphere.w;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) out vec4 albedo;
+layout (location = 1) out vec4 normalDepth;
+
+struct Material {
+    sampler2DArray texture_diffuse1;
+};
+
+in vec2 TexCoords;
+in vec3 Normal;
+in float Depth;
+
+uniform Material material;
+
+// layers of the material's textures in the texture arrays, one RGBA32UI row per material, see MaterialLibrary
+uniform usamplerBuffer materialData;
+uniform int materialIndex;
+
+vec3 MaterialCoords(vec2 texCoords, int slot)
+{
+    return vec3(texCoords, float(texelFetch(materialData, materialIndex)[slot]));
+}
+
+// one atlas frame of an impostor: albedo with coverage, model space normal and depth, all in [0, 1]
+void main()
+{
+    vec4 texColor = texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0));
+    if(texColor.a < 0.1)
+            discard;
+    albedo = vec4(texColor.rgb, 1.0);
+    normalDepth = vec4(normalize(Normal) * 0.5 + 0.5, clamp(Depth, 0.0, 1.0));
+}
\ No newline at end of file
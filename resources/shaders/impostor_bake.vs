@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out float Depth;
+
+// orthographic view of the model space bounding sphere from one atlas frame direction
+uniform mat4 viewProjection;
+uniform vec4 impostorSphere;
+uniform vec3 frameDirection;
+// vertex dequantization, see include/learnopengl/vertex_packing.h
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform vec4 texCoordTransform;
+
+void main()
+{
+    vec3 position = aPos * positionScale + positionOffset;
+    TexCoords = aTexCoords * texCoordTransform.xy + texCoordTransform.zw;
+    Normal = aNormal;
+    // distance in front of the sphere center along the frame direction, 0 at the back and 1 at the front
+    Depth = dot(position - impostorSphere.xyz, frameDirection) / (2.0 * impostorSphere.w) + 0.5;
+    gl_Position = viewProjection * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+uniform sampler2D impostorAlbedo;
+
+// depth pre-pass of an impostor, only the alpha test of impostor.fs
+void main()
+{
+    if(texture(impostorAlbedo, TexCoords).a < 0.5)
+            discard;
+}
\ No newline at end of file
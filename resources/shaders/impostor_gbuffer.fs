@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gSpecular;
+
+struct Material {
+    float shininess;
+};
+
+in vec2 TexCoords;
+in vec3 FragPos;
+flat in mat3 NormalMatrix;
+flat in vec3 FrameOffset;
+
+uniform Material material;
+uniform sampler2D impostorAlbedo;
+uniform sampler2D impostorNormalDepth;
+
+// geometry pass of an impostor, writes the surface impostor.fs would shade with
+void main()
+{
+    vec4 albedo = texture(impostorAlbedo, TexCoords);
+    if(albedo.a < 0.5)
+            discard;
+    vec3 normal = texture(impostorNormalDepth, TexCoords).xyz * 2.0 - 1.0;
+    gAlbedo = vec4(albedo.rgb, 1.0);
+    gNormal = vec4(normalize(NormalMatrix * normal), 0.0);
+    gSpecular = vec4(vec3(0.05), material.shininess / 256.0);
+}
\ No newline at end of file
@@ -1,16 +1,16 @@
 #version 330 core
 out vec4 FragColor;
 
+// light structs mirror include/learnopengl/lights.h, point lights are fetched from pointLightData
 struct PointLight {
     vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
     float constant;
+    vec3 ambient;
     float linear;
+    vec3 diffuse;
     float quadratic;
+    vec3 specular;
+    float radius;
 };
 
 struct DirLight {
@@ -24,22 +24,26 @@ struct DirLight {
 
 
 struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_specular1;
-    sampler2D texture_normal;
+    sampler2DArray texture_diffuse1;
+    sampler2DArray texture_specular1;
+    sampler2DArray texture_normal;
     float shininess;
 };
 
 struct SpotLight {
     vec3 position;
+    float cutOff;
     vec3 direction;
+    float outerCutOff;
 
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
+};
 
-    float cutOff;
-    float outerCutOff;
+struct ClusterGrid {
+    ivec4 size;
+    vec4 params;
 };
 
 
@@ -52,14 +56,34 @@ in mat3 TBNP;//inverse
 vec2 TexCoords;
 
 
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
-uniform PointLight pointLight;
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    ClusterGrid clusters;
+};
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
 uniform Material material;
+
+// layers of the material's textures in the texture arrays, one RGBA32UI row per material, see MaterialLibrary
+uniform usamplerBuffer materialData;
+uniform int materialIndex;
+
+vec3 MaterialCoords(vec2 texCoords, int slot)
+{
+    return vec3(texCoords, float(texelFetch(materialData, materialIndex)[slot]));
+}
+
+// clustered point lights, see include/learnopengl/clustered_lighting.h
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer lightIndexData;
 uniform float height_scale;
 uniform bool parallaxMappingToggle;
 
-uniform vec3 viewPosition;
 // calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -72,25 +96,55 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // fade out towards the culling radius so lights don't pop at cluster borders
+    float window = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).xxx);
+    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)));
+    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)));
+    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, MaterialCoords(TexCoords, 1)).xxx);
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
     return (ambient + diffuse + specular);
 }
 
+PointLight FetchPointLight(int index)
+{
+    vec4 t0 = texelFetch(pointLightData, 4 * index);
+    vec4 t1 = texelFetch(pointLightData, 4 * index + 1);
+    vec4 t2 = texelFetch(pointLightData, 4 * index + 2);
+    vec4 t3 = texelFetch(pointLightData, 4 * index + 3);
+    PointLight light;
+    light.position = t0.xyz;
+    light.constant = t0.w;
+    light.ambient = t1.xyz;
+    light.linear = t1.w;
+    light.diffuse = t2.xyz;
+    light.quadratic = t2.w;
+    light.specular = t3.xyz;
+    light.radius = t3.w;
+    return light;
+}
+
+// index of the cluster a fragment falls into, matches ClusteredLighting on the CPU side
+int ClusterIndex(vec3 fragPos)
+{
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusters.params.xy), clusters.size.xy - 1);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = clamp(int(floor(log(depth) * clusters.params.z + clusters.params.w)), 0, clusters.size.z - 1);
+    return (slice * clusters.size.y + tile.y) * clusters.size.x + tile.x;
+}
+
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 {
     vec3 lightDir = normalize(-dirLight.direction);
     float diff = max(dot(normal, lightDir), 0.0);
     vec3 halfwayDir = normalize(lightDir + viewDir);
     float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    vec3 ambient  = light.ambient  * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient  = light.ambient  * vec3(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)));
+    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)));
+    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, MaterialCoords(TexCoords, 1)));
     return (ambient + diffuse + specular);
 }
 
@@ -107,9 +161,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient  = intensity * light.ambient  * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse  = intensity * light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = intensity * light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient  = intensity * light.ambient  * vec3(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)));
+    vec3 diffuse  = intensity * light.diffuse * diff * vec3(texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0)));
+    vec3 specular = intensity * light.specular * spec * vec3(texture(material.texture_specular1, MaterialCoords(TexCoords, 1)));
 
     return (ambient + diffuse + specular);
 }
@@ -129,12 +183,12 @@ vec2 ParallaxMapping(vec2 texCoords, vec3 lViewDir){
     vec2 currentTexCoords = texCoords;
     //loaded the displacement map as the specular texture, used for both because it looks similar
     //1 - height because its not an inverse displacement map
-    float currentDepthMapValue = 1 - texture(material.texture_specular1, currentTexCoords).r;
+    float currentDepthMapValue = 1 - texture(material.texture_specular1, MaterialCoords(currentTexCoords, 1)).r;
 
     while(currentLayerDepth < currentDepthMapValue)
     {
         currentTexCoords -= deltaTexCoords;
-        currentDepthMapValue = 1 - texture(material.texture_specular1, currentTexCoords).r; // 1 - here too
+        currentDepthMapValue = 1 - texture(material.texture_specular1, MaterialCoords(currentTexCoords, 1)).r; // 1 - here too
         currentLayerDepth += layerDepth;
     }
 
@@ -152,15 +206,19 @@ void main()
     }
 
 
-    vec3 normal = texture(material.texture_normal, TexCoords).rgb;
+    vec3 normal = texture(material.texture_normal, MaterialCoords(TexCoords, 2)).rgb;
     normal = normal * 2.0 - 1.0;
     normal = normalize(TBN * normal);
 
 
     vec3 result = CalcDirLight(dirLight, normal, viewDir);
-    result += CalcPointLight(pointLight, normal, FragPos, viewDir);
+    uvec2 cluster = texelFetch(clusterData, ClusterIndex(FragPos)).rg;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int lightIndex = int(texelFetch(lightIndexData, int(cluster.x + i)).r);
+        result += CalcPointLight(FetchPointLight(lightIndex), normal, FragPos, viewDir);
+    }
     result += CalcSpotLight(spotLight, normal, FragPos, viewDir);
-    vec4 texColor = texture(material.texture_diffuse1, TexCoords);
+    vec4 texColor = texture(material.texture_diffuse1, MaterialCoords(TexCoords, 0));
     if(texColor.a < 0.1)
             discard;
     FragColor = vec4(result, texColor.a);
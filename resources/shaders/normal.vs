@@ -2,30 +2,41 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+// w is the bitangent sign, 1 for the float layout that has no sign
+layout (location = 3) in vec4 aTangent;
 
 out vec3 FragPos;
 out vec2 texCoords;
 out mat3 TBN;
 out mat3 TBNP;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
 uniform mat4 model;
+// vertex dequantization, see include/learnopengl/vertex_packing.h
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform vec4 texCoordTransform;
+
+// the depth pre-pass reuses this shader, its depth has to match the main pass exactly for GL_EQUAL
+invariant gl_Position;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    texCoords = aTexCoords;
+    vec3 position = aPos * positionScale + positionOffset;
+    FragPos = vec3(model * vec4(position, 1.0));
+    texCoords = aTexCoords * texCoordTransform.xy + texCoordTransform.zw;
 
     mat3 normalMatrix = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normalMatrix * aTangent);
+    vec3 T = normalize(normalMatrix * aTangent.xyz);
     vec3 N = normalize(normalMatrix * aNormal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = cross(N, T) * aTangent.w;
 
     TBN = mat3(T, B, N);
     TBNP = transpose(TBN);
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// world space box of the object under test, aPos is a corner of the unit cube
+uniform vec3 boxCenter;
+uniform vec3 boxExtents;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+
+void main()
+{
+    gl_Position = projection * view * vec4(boxCenter + aPos * boxExtents, 1.0);
+}
\ No newline at end of file
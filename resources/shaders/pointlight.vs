@@ -2,10 +2,17 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// vertex dequantization, see include/learnopengl/vertex_packing.h
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform vec4 texCoordTransform;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = projection * view * model * vec4(aPos * positionScale + positionOffset, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <learnopengl/allocation_counter.h>
+
+#include <cstdlib>
+#include <new>
+
+// Replacements of the global allocation functions that count every allocation of the calling thread and
+// otherwise behave like the defaults, on top of malloc and free.
+
+namespace {
+    thread_local unsigned long long threadAllocations = 0;
+
+    void *allocate(std::size_t size)
+    {
+        threadAllocations++;
+        for (;;)
+        {
+            if (void *memory = std::malloc(size ? size : 1))
+                return memory;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+unsigned long long AllocationCounter::Count()
+{
+    return threadAllocations;
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
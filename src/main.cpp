@@ -14,10 +14,33 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/model_loader.h>
+#include <learnopengl/lights.h>
+#include <learnopengl/uniform_buffer.h>
+#include <learnopengl/clustered_lighting.h>
+#include <learnopengl/gbuffer.h>
+#include <learnopengl/occlusion_culling.h>
+#include <learnopengl/impostor.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/camera_path.h>
+#include <learnopengl/benchmark.h>
+#include <learnopengl/simulation_clock.h>
+#include <learnopengl/frame_arena.h>
+#include <learnopengl/allocation_counter.h>
+#include <learnopengl/scene.h>
 
 #include <cubes.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 
@@ -27,15 +50,21 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 
 void processInput(GLFWwindow *window);
 
+void applyInput(Camera &camera, const InputFrame &input, float seconds);
+
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
-void placeModel(Shader& ourShader, Model& ourModel, float rotationAngle, glm::vec3 rotationDirection, glm::vec3 scalingVec, glm::vec3 translationVec, int index);
-void placeModel(Shader& ourShader, Model& ourModel, float rotationAngle, glm::vec3 rotationDirection, glm::vec3 scalingVec, glm::vec3 translationVec);
+struct LitShaderUniforms;
+
+Camera interpolateCamera(const Camera& from, const Camera& to, float alpha);
+void placeModel(RenderQueue& queue, unsigned int pass, const RenderState& state, Model& ourModel, unsigned int occlusionId, const glm::mat4& modelMatrix);
 
 unsigned int loadCubemap(vector<std::string> faces);
+unsigned int createOffscreenFramebuffer(int width, int height);
 
-unsigned int loadTexture(char const * path);
-void renderQuad(unsigned int &quadVAO, unsigned int &quadVBO);
+Mesh createWallMesh(const vector<Texture> &textures);
+void appendStressLights(std::vector<PointLight>& lights, int count, float time);
+void appendUnoccluded(const Model& model, unsigned int firstOcclusionId, const glm::mat4* instances, size_t count, std::vector<glm::mat4>& visible);
 
 
 // settings
@@ -49,38 +78,58 @@ float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
 // timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirLight {
-    glm::vec3 direction;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
+SimulationClock simulationClock;
+double lastFrame = 0.0;
+// input gathered since the last simulation step, see processInput
+InputFrame pendingInput;
+
+// per-draw uniform handles of a shader lit by 2.model_lighting.fs or normal.fs, resolved once after linking.
+// Camera and lights come from the shared uniform blocks.
+struct LitShaderUniforms {
+    Uniform<glm::mat4> model;
+    Uniform<float> shininess;
+    Uniform<float> lodFade;
+
+    explicit LitShaderUniforms(const Shader& shader)
+            : model(shader.uniform<glm::mat4>("model"))
+            , shininess(shader.uniform<float>("material.shininess"))
+            , lodFade(shader.uniform<float>("lodFade")) {}
+
+    // render queue state of an object drawn with shader, whose uniforms these are
+    RenderState State(Shader& shader, float shininessValue, bool cullFace = false) const {
+        RenderState state;
+        state.shader = &shader;
+        state.cullFace = cullFace;
+        state.modelUniform = model;
+        state.shininessUniform = shininess;
+        state.shininess = shininessValue;
+        state.lodFadeUniform = lodFade;
+        return state;
+    }
 };
 
-struct SpotLight {
-    glm::vec3 position;
-    glm::vec3 direction;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-    float cutOff;
-    float outerCutOff;
-
+// shaders one pass over the scene geometry draws with, either forward lit or writing the G-buffer
+struct SceneShaders {
+    Shader& model;
+    Shader& instanced;
+    Shader& wall;
+    Shader& impostor;
+    LitShaderUniforms modelUniforms;
+    LitShaderUniforms instancedUniforms;
+    LitShaderUniforms wallUniforms;
+    LitShaderUniforms impostorUniforms;
+    Uniform<bool> parallaxMappingToggle;
+
+    SceneShaders(Shader& modelShader, Shader& instancedShader, Shader& wallShader, Shader& impostorShader)
+            : model(modelShader)
+            , instanced(instancedShader)
+            , wall(wallShader)
+            , impostor(impostorShader)
+            , modelUniforms(modelShader)
+            , instancedUniforms(instancedShader)
+            , wallUniforms(wallShader)
+            , impostorUniforms(impostorShader)
+            , parallaxMappingToggle(wallShader.uniform<bool>("parallaxMappingToggle")) {}
 };
 
 struct ProgramState {
@@ -91,6 +140,20 @@ struct ProgramState {
     glm::vec3 backpackPosition = glm::vec3(0.0f);
     float backpackScale = 1.0f;
     PointLight pointLight;
+    bool lightStressTest = false;
+    int stressLightCount = 256;
+    bool deferredShading = false;
+    bool depthPrepass = false;
+    bool frustumCulling = true;
+    bool occlusionCulling = false;
+    bool levelOfDetail = true;
+    bool lodCrossFade = true;
+    float lodPixelError = 1.0f;
+    bool impostors = true;
+    float impostorDistance = 40.0f;
+    bool forest = false;
+    bool sortDraws = true;
+    bool perModelTimings = false;
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
 
@@ -130,10 +193,117 @@ void ProgramState::LoadFromFile(std::string filename) {
 }
 
 ProgramState *programState;
+
+// Headless benchmark run: a hidden window renders into an offscreen framebuffer while the camera flies a
+// path, with a fixed time step, and the profiled frame times are written as JSON. A hidden GLFW window
+// still needs an X server, on a machine without a GPU run it under Xvfb with Mesa's llvmpipe.
+//   --benchmark           run the benchmark, the default of the scene_benchmark target
+//   --frames N            recorded frames, after --warmup N unrecorded ones flying the whole path once
+//   --output FILE         JSON report, benchmark.json by default
+//   --camera-path FILE    path recorded with F2, a scripted orbit of the scene by default
+// Input of the fixed simulation steps can be recorded and replayed, also outside the benchmark; a replay
+// advances one step per frame and flies the recorded input instead of the camera path.
+//   --record-input FILE   saves the input of every step on exit
+//   --replay-input FILE   feeds a recorded session back in
+// The scene itself is described by a file, see learnopengl/scene.h.
+//   --scene FILE          resources/scenes/garden.json by default
+struct BenchmarkOptions {
+#ifdef SCENE_BENCHMARK
+    bool enabled = true;
+#else
+    bool enabled = false;
+#endif
+    int frames = 600;
+    int warmupFrames = 30;
+    std::string output = "benchmark.json";
+    std::string cameraPath;
+    std::string recordInput;
+    std::string replayInput;
+    std::string scene = "resources/scenes/garden.json";
+
+    void Parse(int argc, char **argv);
+};
+
+void BenchmarkOptions::Parse(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--benchmark"))
+            enabled = true;
+        else if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--warmup") && hasValue)
+            warmupFrames = std::max(0, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--output") && hasValue)
+            output = argv[++i];
+        else if (!strcmp(argv[i], "--camera-path") && hasValue)
+            cameraPath = argv[++i];
+        else if (!strcmp(argv[i], "--record-input") && hasValue)
+            recordInput = argv[++i];
+        else if (!strcmp(argv[i], "--replay-input") && hasValue)
+            replayInput = argv[++i];
+        else if (!strcmp(argv[i], "--scene") && hasValue)
+            scene = argv[++i];
+        else
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+    }
+}
+
+// camera keys appended with F2, for the benchmark's --camera-path
+const char* const RECORDED_CAMERA_PATH = "resources/camera_path.txt";
+CameraPath recordedCameraPath;
+
+// render queue passes of the scene: the solid walls first so they occlude the alpha-tested plants
+enum ScenePass {
+    SOLID_PASS, ALPHA_TESTED_PASS
+};
+
+// per-frame counters shown in the ImGui windows
+struct FrameStats {
+    unsigned int pointLights = 0;
+    unsigned int clusterLightEntries = 0;
+    size_t vertexBufferBytes = 0;
+    size_t indexBufferBytes = 0;
+    RenderQueueStats renderQueue;
+    // GL state calls of the frame, ImGui aside
+    GLStateCounters glState;
+    CullStats culling;
+    unsigned int occlusionQueries = 0;
+    // heap allocations of the GL thread from the start of the frame to the end of its profiling, and the
+    // per-frame data the frame before took from the frame arena
+    unsigned long long allocations = 0;
+    size_t frameArenaBytes = 0;
+    // scene world matrices recomputed because their transforms moved
+    size_t transformsUpdated = 0;
+};
+FrameStats frameStats;
+
+// view frustum of the current frame and what culling against it let through in the current pass
+Frustum frustum;
+CullStats cullStats;
+
+// frustum the scene is culled against, null when culling is switched off
+const Frustum *cullingFrustum() {
+    return programState->frustumCulling ? &frustum : nullptr;
+}
+
+// occlusion queries of the trees and plants, consulted when occlusion culling is on
+OcclusionCuller *occlusionCuller;
+
+// level of detail selection from the current camera
+LodSelector lodSelector;
+
+// selector the models pick their level of detail with, null draws everything at full detail
+const LodSelector *lodSelection() {
+    return programState->levelOfDetail ? &lodSelector : nullptr;
+}
+
 bool parallaxMappingToggle = true;
 void DrawImGui(ProgramState *programState);
 
-int main() {
+int main(int argc, char **argv) {
+    BenchmarkOptions benchmark;
+    benchmark.Parse(argc, argv);
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -144,6 +314,8 @@ int main() {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (benchmark.enabled)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // glfw window creation
     // --------------------
@@ -171,8 +343,22 @@ int main() {
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
+    InputLog replayedInput, recordedInput;
+    bool replaying = !benchmark.replayInput.empty();
+    if (replaying && !replayedInput.Load(benchmark.replayInput)) {
+        std::cout << "Failed to load input " << benchmark.replayInput << std::endl;
+        replaying = false;
+    }
+
     programState = new ProgramState;
-    programState->LoadFromFile("resources/program_state.txt");
+    // the benchmark and replays start from the defaults or the recorded camera, not from where the last
+    // session left off
+    if (!benchmark.enabled && !replaying)
+        programState->LoadFromFile("resources/program_state.txt");
+    if (replaying && replayedInput.HasStart())
+        programState->camera.SetState(replayedInput.Start());
+    if (benchmark.enabled)
+        glfwSwapInterval(0);
     if (programState->ImGuiEnabled) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
@@ -189,114 +375,333 @@ int main() {
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
     //glEnable(GL_BLEND); discard blending instead
     //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // where the frame ends up: the window, or for the benchmark an offscreen framebuffer, as a hidden
+    // window's default framebuffer need not have any pixels
+    const unsigned int sceneFramebuffer = benchmark.enabled ? createOffscreenFramebuffer(SCR_WIDTH, SCR_HEIGHT) : 0;
+
     // build and compile shaders
     // -------------------------
     Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
+    Shader instancedShader("resources/shaders/2.model_lighting_instanced.vs", "resources/shaders/2.model_lighting.fs");
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader pointLightShader("resources/shaders/pointlight.vs", "resources/shaders/pointlight.fs");
     Shader normalMapShader("resources/shaders/normal.vs", "resources/shaders/normal.fs");
+    // deferred renderer
+    Shader gBufferShader("resources/shaders/2.model_lighting.vs", "resources/shaders/gbuffer.fs");
+    Shader gBufferInstancedShader("resources/shaders/2.model_lighting_instanced.vs", "resources/shaders/gbuffer.fs");
+    Shader gBufferNormalMapShader("resources/shaders/normal.vs", "resources/shaders/gbuffer_normal.fs");
+    Shader deferredLightingShader("resources/shaders/deferred_lighting.vs", "resources/shaders/deferred_lighting.fs");
+    // depth pre-pass, same vertex shaders as the main pass so the depth matches for GL_EQUAL
+    Shader depthPrepassShader("resources/shaders/2.model_lighting.vs", "resources/shaders/depth_prepass.fs");
+    Shader depthPrepassInstancedShader("resources/shaders/2.model_lighting_instanced.vs", "resources/shaders/depth_prepass.fs");
+    Shader depthPrepassWallShader("resources/shaders/normal.vs", "resources/shaders/depth_only.fs");
+    // billboards standing in for distant trees, one per pass, and the shader baking their atlases
+    Shader impostorShader("resources/shaders/impostor.vs", "resources/shaders/impostor.fs");
+    Shader gBufferImpostorShader("resources/shaders/impostor.vs", "resources/shaders/impostor_gbuffer.fs");
+    Shader depthPrepassImpostorShader("resources/shaders/impostor.vs", "resources/shaders/impostor_depth.fs");
+    Shader impostorBakeShader("resources/shaders/impostor_bake.vs", "resources/shaders/impostor_bake.fs");
+
+    // uniform locations used every frame, resolved once
+    SceneShaders forwardShaders(ourShader, instancedShader, normalMapShader, impostorShader);
+    SceneShaders gBufferShaders(gBufferShader, gBufferInstancedShader, gBufferNormalMapShader, gBufferImpostorShader);
+    SceneShaders depthPrepassShaders(depthPrepassShader, depthPrepassInstancedShader, depthPrepassWallShader, depthPrepassImpostorShader);
+    Uniform<glm::mat4> inverseViewProjectionUniform = deferredLightingShader.uniform<glm::mat4>("inverseViewProjection");
+    Uniform<glm::mat4> pointLightModelUniform = pointLightShader.uniform<glm::mat4>("model");
+    Uniform<float> skyboxCoefUniform = skyboxShader.uniform<float>("coef");
+
+    // camera and light state is uploaded once per frame into uniform buffers shared by every shader
+    for (Shader *shader : {&ourShader, &instancedShader, &skyboxShader, &pointLightShader, &normalMapShader,
+                           &gBufferShader, &gBufferInstancedShader, &gBufferNormalMapShader, &deferredLightingShader,
+                           &depthPrepassShader, &depthPrepassInstancedShader, &depthPrepassWallShader,
+                           &impostorShader, &gBufferImpostorShader, &depthPrepassImpostorShader}) {
+        shader->bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        shader->bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+    }
+    UniformBuffer<CameraBlock> cameraBuffer(CAMERA_BLOCK_BINDING);
+    UniformBuffer<LightsBlock> lightsBuffer(LIGHTS_BLOCK_BINDING);
+
+    // point lights are binned into view space clusters every frame
+    ClusteredLighting clusteredLighting;
+    for (Shader *shader : {&ourShader, &instancedShader, &normalMapShader, &deferredLightingShader, &impostorShader})
+        clusteredLighting.SetupShader(*shader);
+
+    GBuffer gBuffer;
+    gBuffer.SetupShader(deferredLightingShader);
+
+    OcclusionCuller occlusion;
+    occlusionCuller = &occlusion;
+
+    for (Shader *shader : {&impostorShader, &gBufferImpostorShader, &depthPrepassImpostorShader})
+        Impostor::SetupShader(*shader);
+
+    // every shader sampling model textures reads them from the texture arrays of the material library
+    for (Shader *shader : {&ourShader, &instancedShader, &normalMapShader, &gBufferShader, &gBufferInstancedShader,
+                           &gBufferNormalMapShader, &depthPrepassShader, &depthPrepassInstancedShader, &impostorBakeShader})
+        MaterialLibrary::SetupShader(*shader);
+    std::vector<PointLight> pointLights;
+
+    // the models, their placement, the lights and the skyboxes
+    Scene scene;
+    std::string sceneError;
+    if (!scene.Load(benchmark.scene, sceneError) || scene.skyboxes.empty()) {
+        std::cout << "Failed to load scene: " << (sceneError.empty() ? "it has no skybox" : sceneError) << std::endl;
+        glfwTerminate();
+        return -1;
+    }
 
     // load models
     // -----------
-    Model appleTreeModel("resources/objects/apple_tree/apple_tree.obj");
-    appleTreeModel.SetShaderTextureNamePrefix("material.");
-
-    Model grassModel("resources/objects/grass/10450_Rectangular_Grass_Patch_v1_iterations-2.obj");
-    grassModel.SetShaderTextureNamePrefix("material.");
-
-    Model oakTreeModel("resources/objects/tree2/Tree.obj");
-    oakTreeModel.SetShaderTextureNamePrefix("material.");
-
-    Model hazelnutBushModel("resources/objects/hazelnut_bush/Hazelnut.obj");
-    hazelnutBushModel.SetShaderTextureNamePrefix("material.");
-
-    Model flower1Model("resources/objects/flower1/marigold.obj");
-    flower1Model.SetShaderTextureNamePrefix("material.");
-
-    Model roseModel("resources/objects/rose/rose.obj");
-    roseModel.SetShaderTextureNamePrefix("material.");
-
-    Model tree3Model("resources/objects/tree3/Tree.obj");
-    roseModel.SetShaderTextureNamePrefix("material.");
-
-    Model angelModel("resources/objects/Angel/18343_Angel_v1.obj");
-    angelModel.SetShaderTextureNamePrefix("material.");
-
-    PointLight pointLight;
-    pointLight.position = glm::vec3(0.0f);
-    pointLight.ambient = glm::vec3(0.1, 0.1, 0.1);
-    pointLight.diffuse = glm::vec3(0.75, 0.2, 0.2);
-    pointLight.specular = glm::vec3(1.0, 0.3, 0.3);
-
-    pointLight.constant = 1.0f;
-    pointLight.linear = 0.001f;
-    pointLight.quadratic = 0.005f;
-
-    DirLight dirLight;
-    dirLight.direction = glm::normalize(glm::vec3(0.15, -1, 0.2));
-    dirLight.ambient = glm::vec3(0.25);
-    dirLight.diffuse = glm::vec3(0.4);
-    dirLight.specular = glm::vec3(0.4);
-
-    SpotLight spotLight;
-    spotLight.position = glm::vec3(0.0f);
-    spotLight.direction = glm::vec3(0.0f, -1.0f, 0.0f);
-    spotLight.ambient = glm::vec3(0.0f);
-    spotLight.diffuse = glm::vec3(0.0f);
-    spotLight.specular = glm::vec3(0.0f);
-    spotLight.cutOff = glm::cos(glm::radians(12.0f));
-    spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+    // import and texture decoding run on worker threads, models are uploaded in the render loop as they finish
+    ModelLoader modelLoader;
+
+    // indexed like scene.models
+    std::vector<Model> models(scene.models.size());
+    for (size_t i = 0; i < models.size(); i++)
+        modelLoader.Load(models[i], scene.models[i].path);
+
+    // the gizmo of the orbiting light
+    Model angelModel;
+    modelLoader.Load(angelModel, "resources/objects/Angel/18343_Angel_v1.obj");
+
+    // atlases of the trees that turn into billboards in the distance, baked once their models are uploaded;
+    // null for models without one
+    std::vector<std::unique_ptr<Impostor>> impostors(models.size());
+    for (size_t i = 0; i < models.size(); i++)
+        if (scene.models[i].impostor)
+            impostors[i].reset(new Impostor());
+
+    LightsBlock lights = {};
+    lights.dirLight = scene.dirLight;
+    lights.spotLight = scene.spotLight;
+    DirLight& dirLight = lights.dirLight;
+    SpotLight& spotLight = lights.spotLight;
+
+    // the first point light of the scene orbits it, the others stay where the scene puts them
+    PointLight pointLight = scene.pointLights.empty() ? PointLight() : scene.pointLights[0];
+
+    // occlusion query ids, one per instance in the order of the scene's instance table
+    const unsigned int instanceOcclusionId = occlusion.Register(scene.instances.Size());
+    // the forest around the scene is the layer the Forest checkbox switches
+    const int forestLayer = scene.LayerIndex("forest");
+    // scratch lists of the instances that passed the occlusion test and of those split by distance
+    std::vector<glm::mat4> unoccluded;
+    std::vector<glm::mat4> nearInstances;
+    std::vector<glm::mat4> farInstances;
+    // all scratch lists are sized for every copy of a model up front, so no view grows them in the loop
+    size_t largestInstanceCount = 0;
+    for (size_t i = 0; i < models.size(); i++) {
+        size_t count = 0;
+        for (unsigned int b = scene.models[i].firstBatch; b < scene.models[i].firstBatch + scene.models[i].batchCount; b++)
+            count += scene.batches[b].count;
+        models[i].ReserveInstances(count);
+        if (impostors[i])
+            impostors[i]->ReserveInstances(count);
+        largestInstanceCount = std::max(largestInstanceCount, count);
+    }
+    unoccluded.reserve(largestInstanceCount);
+    nearInstances.reserve(largestInstanceCount);
+    farInstances.reserve(largestInstanceCount);
     //skybox setup
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
+    GLState::Get().BindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
 
-    vector<std::string> faces {
-        "resources/textures/skybox/bluecloud_ft.jpg",
-        "resources/textures/skybox/bluecloud_bk.jpg",
-        "resources/textures/skybox/bluecloud_up.jpg",
-        "resources/textures/skybox/bluecloud_dn.jpg",
-        "resources/textures/skybox/bluecloud_rt.jpg",
-        "resources/textures/skybox/bluecloud_lf.jpg"
-    };
-    unsigned int skyboxTexture = loadCubemap(faces);
-
-    vector<std::string> facesFOM {
-            "resources/textures/skybox/browncloud_ft.jpg",
-            "resources/textures/skybox/browncloud_bk.jpg",
-            "resources/textures/skybox/browncloud_up.jpg",
-            "resources/textures/skybox/browncloud_dn.jpg",
-            "resources/textures/skybox/browncloud_rt.jpg",
-            "resources/textures/skybox/browncloud_lf.jpg"
-    };
-    unsigned int skyboxTextureFOM = loadCubemap(facesFOM);
+    // the first skybox of the scene is the sky, the second (if any) the one it turns into after the fall
+    unsigned int skyboxTexture = loadCubemap(scene.skyboxes[0].faces);
+    unsigned int skyboxTextureFOM = loadCubemap(scene.skyboxes[std::min<size_t>(1, scene.skyboxes.size() - 1)].faces);
 
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
     skyboxShader.setInt("skyboxFOM", 1);
     skyboxShader.setFloat("coef", 0.0f);
 
-    unsigned int wallDiffuseMap = loadTexture(FileSystem::getPath("resources/textures/wood_wall/wall-2-blackforest-DIFFUSE.jpg").c_str());
-    unsigned int wallDisplacementMap = loadTexture(FileSystem::getPath("resources/textures/wood_wall/wall-2-blackforest-DISP.jpg").c_str());
-    unsigned int wallNormalMap  = loadTexture(FileSystem::getPath("resources/textures/wood_wall/wall-2-blackforest-NORM.jpg").c_str());
+    // the wall textures go through the material library like the model ones, the displacement map in the specular slot
+    string wallDirectory = FileSystem::getPath("resources/textures/wood_wall");
+    vector<Texture> wallTextures = {
+            {TextureFromFile("wall-2-blackforest-DIFFUSE.jpg", wallDirectory), "texture_diffuse", "wall-2-blackforest-DIFFUSE.jpg"},
+            {TextureFromFile("wall-2-blackforest-DISP.jpg", wallDirectory), "texture_specular", "wall-2-blackforest-DISP.jpg"},
+            {TextureFromFile("wall-2-blackforest-NORM.jpg", wallDirectory), "texture_normal", "wall-2-blackforest-NORM.jpg"}
+    };
+
+    Mesh wallMesh = createWallMesh(wallTextures);
+
+    for (Shader *shader : {&normalMapShader, &gBufferNormalMapShader}) {
+        shader->use();
+        shader->setFloat("height_scale", 0.08f);
+    }
+
+    // model space bounds of the wall quad
+    const AABB wallBox = wallMesh.Box;
+
+    // the draws of one pass over the scene, sorted by state before they are issued
+    RenderQueue sceneQueue;
 
-    unsigned int wallVAO, wallVBO;
+    // the camera the frame is rendered from, between the simulated camera before and after the last step
+    Camera viewCamera = programState->camera;
+
+    auto layerVisible = [&](unsigned int layer) {
+        return (int) layer != forestLayer || programState->forest;
+    };
+
+    // Instances of a model in the visible layers that occlusion culling lets through. They are read straight
+    // from the scene's instance table when they are one batch and nothing is tested, else gathered in
+    // unoccluded, so the model goes out as a single instanced draw either way.
+    auto visibleInstances = [&](const Model& model, const SceneModel& description, size_t& count) -> const glm::mat4* {
+        const SceneBatch* first = scene.batches.data() + description.firstBatch;
+        const SceneBatch* end = first + description.batchCount;
+        const SceneBatch* only = nullptr;
+        int visibleBatches = 0;
+        for (const SceneBatch* batch = first; batch != end; batch++)
+            if (layerVisible(batch->layer)) {
+                only = batch;
+                visibleBatches++;
+            }
+        if (visibleBatches == 1 && !(programState->occlusionCulling && model.IsReady())) {
+            count = only->count;
+            return scene.instances.transforms.data() + only->first;
+        }
+        unoccluded.clear();
+        for (const SceneBatch* batch = first; batch != end; batch++)
+            if (layerVisible(batch->layer))
+                appendUnoccluded(model, instanceOcclusionId + batch->first, scene.instances.transforms.data() + batch->first,
+                                 batch->count, unoccluded);
+        count = unoccluded.size();
+        return unoccluded.data();
+    };
+
+    // Instanced draw of a model, queued with state. With an impostor, instances further than the impostor
+    // distance are drawn as billboards right away instead.
+    auto drawInstances = [&](SceneShaders& shaders, const RenderState& state, Model& model, Impostor* impostor,
+                             const glm::mat4* instances, size_t count) {
+        if (!impostor || !programState->impostors || !impostor->IsBaked()) {
+            model.EnqueueInstanced(sceneQueue, ALPHA_TESTED_PASS, state, instances, count, cullingFrustum(), cullStats, lodSelection());
+            return;
+        }
+        nearInstances.clear();
+        farInstances.clear();
+        float impostorDistance2 = programState->impostorDistance * programState->impostorDistance;
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 offset = glm::vec3(instances[i] * glm::vec4(model.Sphere.center, 1.0f)) - viewCamera.Position;
+            (glm::dot(offset, offset) > impostorDistance2 ? farInstances : nearInstances).push_back(instances[i]);
+        }
+        model.EnqueueInstanced(sceneQueue, ALPHA_TESTED_PASS, state, nearInstances, cullingFrustum(), cullStats, lodSelection());
+        if (farInstances.empty())
+            return;
+        shaders.impostor.use();
+        shaders.impostorUniforms.shininess.set(state.shininess);
+        impostor->DrawInstanced(shaders.impostor, farInstances, cullingFrustum(), cullStats);
+    };
+
+    // scene geometry, drawn lit in the forward pass, into the G-buffer or depth only. The models and walls
+    // go through the render queue, which is sorted at the end and executed one pass at a time, so the
+    // "Walls" and "Models" scopes time the draws of each. Queueing is timed apart, with the impostor
+    // billboards it draws right away. Profiled as a scope called name.
+    auto renderScene = [&](SceneShaders& shaders, const char* name) {
+        ProfileScope scope(name);
+        sceneQueue.Clear(viewCamera.Position, 100.0f);
+
+        Profiler::Get().Begin("Queue models");
+        for (size_t i = 0; i < models.size(); i++) {
+            const SceneModel& description = scene.models[i];
+            // repeated models go out as one instanced draw call per mesh
+            if (description.instanced) {
+                size_t count = 0;
+                const glm::mat4* instances = visibleInstances(models[i], description, count);
+                RenderState state = shaders.instancedUniforms.State(shaders.instanced, description.shininess, description.cullFace);
+                state.group = i;
+                drawInstances(shaders, state, models[i], impostors[i].get(), instances, count);
+                continue;
+            }
+            RenderState state = shaders.modelUniforms.State(shaders.model, description.shininess, description.cullFace);
+            state.group = i;
+            for (unsigned int b = description.firstBatch; b < description.firstBatch + description.batchCount; b++) {
+                const SceneBatch& batch = scene.batches[b];
+                if (!layerVisible(batch.layer))
+                    continue;
+                for (unsigned int instance = batch.first; instance < batch.first + batch.count; instance++)
+                    placeModel(sceneQueue, ALPHA_TESTED_PASS, state, models[i], instanceOcclusionId + instance,
+                               scene.instances.transforms[instance]);
+            }
+        }
+        Profiler::Get().End();
+
+        //render walls
+        Profiler::Get().Begin("Queue walls");
+        shaders.wall.use();
+        shaders.parallaxMappingToggle.set(parallaxMappingToggle);
+        RenderState wall = shaders.wallUniforms.State(shaders.wall, 8.0f);
+        for(int i = 0; i < 4; i++){
+            glm::mat4 wallModel = glm::mat4(1.0);
+            wallModel = glm::rotate(wallModel, glm::radians(90.0f * i), glm::vec3(0.0f, 1.0f, 0.0f));
+            wallModel = glm::translate(wallModel, glm::vec3(0.0f, 0.0f, -30.0f));
+            if (cullingFrustum() && !frustum.Intersects(wallBox.Transformed(wallModel))) {
+                cullStats.objectsCulled++;
+                cullStats.meshesCulled++;
+                continue;
+            }
+            cullStats.objectsDrawn++;
+            cullStats.meshesDrawn++;
+            wall.model = wallModel;
+            sceneQueue.Add(SOLID_PASS, sceneQueue.AddState(wall), Mesh::DrawCommand{&wallMesh, 0, 0, 0, 0},
+                           glm::vec3(wallModel * glm::vec4(wallBox.Center(), 1.0f)));
+        }
+        Profiler::Get().End();
+
+        sceneQueue.Sort(programState->sortDraws);
+        // the solid walls first, so they occlude the alpha-tested plants
+        Profiler::Get().Begin("Walls");
+        sceneQueue.ExecutePass(SOLID_PASS);
+        Profiler::Get().End();
+        Profiler::Get().Begin("Models");
+        if (programState->perModelTimings) {
+            // one scope per model, its draws still in sorted order; the impostors are in the queueing scope
+            for (size_t i = 0; i < models.size(); i++) {
+                ProfileScope modelScope(scene.models[i].name.c_str());
+                sceneQueue.ExecutePass(ALPHA_TESTED_PASS, i);
+            }
+        } else {
+            sceneQueue.ExecutePass(ALPHA_TESTED_PASS);
+        }
+        Profiler::Get().End();
+    };
+
+    // Draws the scene with the given shaders. With the depth pre-pass on, the depth of the alpha-tested
+    // geometry is laid down first with a cheap shader, and the expensive pass only shades the one
+    // fragment per pixel that matches it with GL_EQUAL.
+    auto shadeScene = [&](SceneShaders& shaders) {
+        if (programState->depthPrepass) {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            renderScene(depthPrepassShaders, "Depth pre-pass");
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            GLState::Get().DepthFunc(GL_EQUAL);
+            GLState::Get().DepthMask(GL_FALSE);
+        }
+        // only the shading pass is counted
+        cullStats = CullStats();
+        renderScene(shaders, "Scene");
+        frameStats.renderQueue = sceneQueue.Stats();
+        GLState::Get().DepthFunc(GL_LESS);
+        GLState::Get().DepthMask(GL_TRUE);
+
+        // the finished depth buffer decides what is drawn next frame
+        if (programState->occlusionCulling) {
+            ProfileScope scope("Occlusion queries");
+            occlusionCuller->IssueQueries();
+        }
 
-    normalMapShader.use();
-    normalMapShader.setInt("material.texture_diffuse1", 0);
-    normalMapShader.setInt("material.texture_specular1", 1);
-    normalMapShader.setInt("material.texture_normal", 2);
-    normalMapShader.setFloat("height_scale", 0.08f);
+        frameStats.culling = cullStats;
+        frameStats.occlusionQueries = programState->occlusionCulling ? occlusionCuller->QueriesIssued() : 0;
+    };
 
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -304,25 +709,92 @@ int main() {
     // render loop
     // -----------
     bool fallOfMan = false;
-    float timeOfFall = glfwGetTime();
+    float timeOfFall = 0.0f;
     float coef = 0.0f;
+
+    CameraPath benchmarkPath = CameraPath::Orbit(glm::vec3(0.0f, 3.0f, 0.0f), 22.0f, 3.0f, 10.0f);
+    BenchmarkReport benchmarkReport;
+    if (benchmark.enabled) {
+        if (!benchmark.cameraPath.empty() && !benchmarkPath.Load(benchmark.cameraPath))
+            std::cout << "Failed to load camera path " << benchmark.cameraPath << ", flying the default orbit" << std::endl;
+        // every model is in the scene from the first frame on
+        modelLoader.WaitAll();
+    }
+
+    recordedInput.SetStart(programState->camera.GetState());
+    // one step per frame where the frames have to come out the same on every machine
+    const bool lockstep = benchmark.enabled || replaying;
+    Camera previousCamera = programState->camera;
+    lastFrame = glfwGetTime();
+
     while (!glfwWindowShouldClose(window)) {
+        const unsigned long long frameAllocationStart = AllocationCounter::Count();
+        FrameArena::Get().Reset();
+        frameStats.frameArenaBytes = FrameArena::Get().LastFrameBytes();
+
         // per-frame time logic
         // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        // input
-        // -----
+        double frameTime = glfwGetTime();
+        if (lockstep)
+            simulationClock.AdvanceSteps(1);
+        else
+            simulationClock.Advance(frameTime - lastFrame);
+        lastFrame = frameTime;
+        Profiler& profiler = Profiler::Get();
+        profiler.BeginFrame();
+        // upload models whose background loading finished since the last frame
+        profiler.Begin("Uploads");
+        modelLoader.ProcessUploads();
+        for (size_t i = 0; i < models.size(); i++)
+            if (impostors[i])
+                impostors[i]->Bake(models[i], impostorBakeShader);
+        profiler.End();
+        frameStats.vertexBufferBytes = wallMesh.VertexBufferBytes() + angelModel.VertexBufferBytes();
+        frameStats.indexBufferBytes = wallMesh.IndexBufferBytes() + angelModel.IndexBufferBytes();
+        for (const Model& model : models) {
+            frameStats.vertexBufferBytes += model.VertexBufferBytes();
+            frameStats.indexBufferBytes += model.IndexBufferBytes();
+        }
+
+        // input and simulation
+        // --------------------
+        profiler.Begin("Frame setup");
         processInput(window);
-        if(!fallOfMan && programState->camera.Position.x * programState->camera.Position.x + programState->camera.Position.z * programState->camera.Position.z < 25.0f){
-            fallOfMan = true;
-            timeOfFall = currentFrame;
-            cerr << "fall of man\n";
+        while (simulationClock.Step()) {
+            uint64_t step = simulationClock.Steps() - 1;
+            InputFrame input = replaying ? replayedInput.At(step) : pendingInput;
+            pendingInput.mouseX = pendingInput.mouseY = pendingInput.scroll = 0.0f;
+            if (!benchmark.recordInput.empty())
+                recordedInput.Add(input);
+
+            previousCamera = programState->camera;
+            if (benchmark.enabled && !replaying) {
+                // the warm-up flies the whole path once, so every view the run sees has been seen before
+                if (step < (uint64_t) benchmark.warmupFrames)
+                    benchmarkPath.Apply((float) step / std::max(benchmark.warmupFrames - 1, 1), programState->camera);
+                else
+                    benchmarkPath.Apply((float) (step - benchmark.warmupFrames) / std::max(benchmark.frames - 1, 1), programState->camera);
+            }
+            else
+                applyInput(programState->camera, input, simulationClock.StepSeconds());
+            if(!fallOfMan && programState->camera.Position.x * programState->camera.Position.x + programState->camera.Position.z * programState->camera.Position.z < 25.0f){
+                fallOfMan = true;
+                timeOfFall = simulationClock.Time();
+                cerr << "fall of man\n";
+            }
         }
+        if (replaying && !benchmark.enabled && simulationClock.Steps() >= replayedInput.Size())
+            glfwSetWindowShouldClose(window, true);
+        viewCamera = interpolateCamera(previousCamera, programState->camera, simulationClock.Alpha());
+        // everything animated below follows the simulated time the frame shows
+        float currentFrame = simulationClock.InterpolatedTime();
+        // spinning entries move with it and reach the instance table, the static rest of the scene costs nothing here
+        scene.Animate(currentFrame);
+        frameStats.transformsUpdated = scene.UpdateTransforms();
 
         // render
         // ------
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -332,201 +804,127 @@ int main() {
 
         if(fallOfMan) {
 
-            coef = (currentFrame-timeOfFall < 7.0f ? (currentFrame-timeOfFall)/7.0f : 1.0f);
+            coef = glm::clamp((currentFrame-timeOfFall)/7.0f, 0.0f, 1.0f);
 
             spotLight.position = pointLight.position;
-            spotLight.direction = glm::normalize(programState->camera.Position - spotLight.position);
+            spotLight.direction = glm::normalize(viewCamera.Position - spotLight.position);
             spotLight.diffuse = glm::vec3(1.0f, 0.0f, 0.0f);
             spotLight.specular = glm::vec3(1.0f, 0.0f, 0.0f);
 
-            dirLight.ambient = glm::vec3(0.25) * (1.0f-(4.0f/7.0f)*coef);
-            dirLight.diffuse = glm::vec3(0.4) * (1.0f-(4.0f/7.0f)*coef);
-            dirLight.specular = glm::vec3(0.4) * (1.0f-(4.0f/7.0f)*coef);
+            dirLight.ambient = scene.dirLight.ambient * (1.0f-(4.0f/7.0f)*coef);
+            dirLight.diffuse = scene.dirLight.diffuse * (1.0f-(4.0f/7.0f)*coef);
+            dirLight.specular = scene.dirLight.specular * (1.0f-(4.0f/7.0f)*coef);
 
         }
 
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
-
-        ourShader.setVec3("pointLight.position", pointLight.position);
-        ourShader.setVec3("pointLight.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight.specular", pointLight.specular);
-        ourShader.setFloat("pointLight.constant", pointLight.constant);
-        ourShader.setFloat("pointLight.linear", pointLight.linear);
-        ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 16.0f);
-
-        ourShader.setVec3("dirLight.direction", dirLight.direction);
-        ourShader.setVec3("dirLight.ambient", dirLight.ambient);
-        ourShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        ourShader.setVec3("dirLight.specular", dirLight.specular);
-
-        ourShader.setVec3("spotLight.position", spotLight.position);
-        ourShader.setVec3("spotLight.direction", spotLight.direction);
-        ourShader.setVec3("spotLight.ambient", spotLight.ambient);
-        ourShader.setVec3("spotLight.diffuse", spotLight.diffuse);
-        ourShader.setVec3("spotLight.specular", spotLight.specular);
-        ourShader.setFloat("spotLight.cutOff", spotLight.cutOff);
-        ourShader.setFloat("spotLight.outerCutOff", spotLight.outerCutOff);
-
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        // render appleTreeModel
-        placeModel(ourShader, appleTreeModel, 0, glm::vec3(1,0,0), glm::vec3(20), glm::vec3(0, 6.3, -6.5));
-
-
-        //render tree2
-        placeModel(ourShader, oakTreeModel, 0.0f, glm::vec3(0,1,0), glm::vec3(3), glm::vec3(10, 1.5, 15));
-        placeModel(ourShader, oakTreeModel, -30.0f, glm::vec3(0,1,0), glm::vec3(3.5), glm::vec3(17, 1.5, -2));
-        placeModel(ourShader, oakTreeModel, 30.0f, glm::vec3(0,1,0), glm::vec3(2.5), glm::vec3(20, 1.5, 7));
-
-        //render hazelnut
-        placeModel(ourShader, hazelnutBushModel, 0.0f, glm::vec3(0,0,0), glm::vec3(0.7), glm::vec3(-10, 0, -10));
-
-
-        //render tree3
-        placeModel(ourShader, tree3Model, 0, glm::vec3(1.0f), glm::vec3(2.7f), glm::vec3(20, 2, -20));
-        placeModel(ourShader, tree3Model, 0, glm::vec3(1.0f), glm::vec3(2.25f), glm::vec3(12, 2, -16));
-
-        //render flower1
-        std::vector<glm::vec3> flower1Coordinates = {
-                glm::vec3(-5, 1.2, 5),
-                glm::vec3(-10, 1.2, 2),
-                glm::vec3(-20, 1.2, -3),
-                glm::vec3(-5, 1.2, -15),
-                glm::vec3(5, 1.2, -12),
-                glm::vec3(-12, 1.2, -5),
-                glm::vec3(6, 1.2, 5),
-                glm::vec3(-5, 1.2, 13)
-        };
-        for(int i = 0; i < flower1Coordinates.size(); i++) {
-            placeModel(ourShader, flower1Model, -90.0f, glm::vec3(1, glm::cos((float) i) * 0.18, 0),
-                       glm::vec3(0.06 + 0.015 * glm::sin(i)), flower1Coordinates[i], i);
-            placeModel(ourShader, flower1Model, -90.0f, glm::vec3(1, glm::cos((float) i) * 0.18, 0),
-                       glm::vec3(0.06 + 0.015 * glm::sin(i)), glm::vec3 (1.1*flower1Coordinates[i].z, flower1Coordinates[i].y, 1.2*flower1Coordinates[i].x), i);
-        }
-
-        //render roses
-        ourShader.setFloat("material.shininess", 64.0f);
-        std::vector<glm::vec3> roseCoordinates = {
-                glm::vec3(-5, 1.2, -5),
-                glm::vec3(-10, 1.2, -2),
-                glm::vec3(20, 1.2, 3),
-                glm::vec3(-5, 1.2, 15),
-                glm::vec3(-5, 1.2, 12),
-                glm::vec3(12, 1.2, 5),
-                glm::vec3(6, 1.2, -5),
-                glm::vec3(5, 1.2, -13),
-                glm::vec3(15, 1.2, -18)
-        };
-        for(int i = 0; i < roseCoordinates.size(); i++){
-            placeModel(ourShader, roseModel, 0, glm::vec3(1, glm::cos((float)i)*0.18,0),
-                       glm::vec3(0.03 + 0.008 * glm::sin(i)), roseCoordinates[i], i);
-            placeModel(ourShader, roseModel, 0, glm::vec3(1, glm::cos((float)i)*0.18,0),
-                       glm::vec3(0.03 + 0.008 * glm::sin(i)), glm::vec3 (1.1*roseCoordinates[i].z, roseCoordinates[i].y, 1.2*roseCoordinates[i].x), i);
+        float fovy = glm::radians(viewCamera.Zoom);
+        float aspect = (float) SCR_WIDTH / (float) SCR_HEIGHT;
+        glm::mat4 projection = glm::perspective(fovy, aspect, 0.1f, 100.0f);
+        glm::mat4 view = viewCamera.GetViewMatrix();
+        frustum = Frustum::FromMatrix(projection * view);
+        // also while occlusion culling is off, so results from before it was switched off are dropped
+        occlusion.BeginFrame(cullingFrustum(), viewCamera.Position);
+
+        pointLights.clear();
+        pointLights.push_back(pointLight);
+        if (scene.pointLights.size() > 1)
+            pointLights.insert(pointLights.end(), scene.pointLights.begin() + 1, scene.pointLights.end());
+        if (programState->lightStressTest)
+            appendStressLights(pointLights, programState->stressLightCount, currentFrame);
+        int framebufferWidth = SCR_WIDTH, framebufferHeight = SCR_HEIGHT;
+        if (!benchmark.enabled)
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        lodSelector = LodSelector::FromCamera(viewCamera.Position, projection, framebufferHeight);
+        lodSelector.maxPixelError = programState->lodPixelError;
+        lodSelector.crossFade = programState->lodCrossFade;
+        clusteredLighting.Update(pointLights, view, fovy, aspect, 0.1f, 100.0f, framebufferWidth, framebufferHeight);
+        clusteredLighting.Bind();
+        lights.clusters = clusteredLighting.Grid();
+        frameStats.pointLights = clusteredLighting.LightCount();
+        frameStats.clusterLightEntries = clusteredLighting.IndexCount();
+
+        CameraBlock cameraBlock;
+        cameraBlock.projection = projection;
+        cameraBlock.view = view;
+        cameraBlock.viewPosition = viewCamera.Position;
+        cameraBuffer.Upload(cameraBlock);
+        lightsBuffer.Upload(lights);
+        profiler.End();
+
+        if (programState->deferredShading) {
+            // geometry pass into the G-buffer, then every covered pixel is lit once by a fullscreen pass
+            gBuffer.Resize(framebufferWidth, framebufferHeight);
+            glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.FBO);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            shadeScene(gBufferShaders);
+            glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+
+            ProfileScope scope("Deferred lighting");
+            GLState::Get().SetEnabled(GL_DEPTH_TEST, false);
+            deferredLightingShader.use();
+            inverseViewProjectionUniform.set(glm::inverse(projection * view));
+            gBuffer.BindTextures();
+            gBuffer.DrawFullscreenTriangle();
+            GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+            // the light gizmo and skybox are still drawn forward, against the scene depth
+            gBuffer.BlitDepthTo(sceneFramebuffer);
+        } else {
+            shadeScene(forwardShaders);
         }
-        ourShader.setFloat("material.shininess", 16.0f);
-
-        //objects that are face culled
-        glEnable(GL_CULL_FACE);
-
-        //render grassModel
-        placeModel(ourShader, grassModel, -90.0f, glm::vec3(1,0,0), glm::vec3(0.2), glm::vec3(0));
-
-        glDisable(GL_CULL_FACE);
 
         //point light source
-        pointLightShader.use();
-        pointLightShader.setMat4("projection", projection);
-        pointLightShader.setMat4("view", view);
-
-        glm::mat4 modelMatrix = glm::mat4(1.0);
-        modelMatrix = glm::translate(modelMatrix, pointLight.position);
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(0.3));
-        modelMatrix = glm::rotate(modelMatrix, 4*currentFrame + (fallOfMan ? 10 * (currentFrame-timeOfFall) : 0.0f), glm::vec3(0, 1, 0));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.f), glm::vec3(1, 0, 0));
-
-        pointLightShader.setMat4("model", modelMatrix);
-        angelModel.Draw(pointLightShader);
-
-        //render walls
-
-        normalMapShader.use();
-
-        normalMapShader.setVec3("pointLight.position", pointLight.position);
-        normalMapShader.setVec3("pointLight.ambient", pointLight.ambient);
-        normalMapShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-        normalMapShader.setVec3("pointLight.specular", pointLight.specular);
-        normalMapShader.setFloat("pointLight.constant", pointLight.constant);
-        normalMapShader.setFloat("pointLight.linear", pointLight.linear);
-        normalMapShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        normalMapShader.setVec3("viewPosition", programState->camera.Position);
-        normalMapShader.setFloat("material.shininess", 8.0f);
-
-        normalMapShader.setVec3("dirLight.direction", dirLight.direction);
-        normalMapShader.setVec3("dirLight.ambient", dirLight.ambient);
-        normalMapShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        normalMapShader.setVec3("dirLight.specular", dirLight.specular);
-
-        normalMapShader.setVec3("spotLight.position", spotLight.position);
-        normalMapShader.setVec3("spotLight.direction", spotLight.direction);
-        normalMapShader.setVec3("spotLight.ambient", spotLight.ambient);
-        normalMapShader.setVec3("spotLight.diffuse", spotLight.diffuse);
-        normalMapShader.setVec3("spotLight.specular", spotLight.specular);
-        normalMapShader.setFloat("spotLight.cutOff", spotLight.cutOff);
-        normalMapShader.setFloat("spotLight.outerCutOff", spotLight.outerCutOff);
-
-        normalMapShader.setMat4("projection", projection);
-        normalMapShader.setMat4("view", view);
-
-        normalMapShader.setBool("parallaxMappingToggle", parallaxMappingToggle);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, wallDiffuseMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, wallDisplacementMap);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, wallNormalMap);
+        {
+            ProfileScope scope("Light gizmo");
+            pointLightShader.use();
 
+            glm::mat4 modelMatrix = glm::mat4(1.0);
+            modelMatrix = glm::translate(modelMatrix, pointLight.position);
+            modelMatrix = glm::scale(modelMatrix, glm::vec3(0.3));
+            modelMatrix = glm::rotate(modelMatrix, 4*currentFrame + (fallOfMan ? 10 * (currentFrame-timeOfFall) : 0.0f), glm::vec3(0, 1, 0));
+            modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.f), glm::vec3(1, 0, 0));
 
-        for(int i = 0; i < 4; i++){
-            glm::mat4 wallModel = glm::mat4(1.0);
-            wallModel = glm::rotate(wallModel, glm::radians(90.0f * i), glm::vec3(0.0f, 1.0f, 0.0f));
-            wallModel = glm::translate(wallModel, glm::vec3(0.0f, 0.0f, -30.0f));
-            normalMapShader.setMat4("model", wallModel);
-            renderQuad(wallVAO, wallVBO);
+            pointLightModelUniform.set(modelMatrix);
+            angelModel.Draw(pointLightShader);
         }
 
         //skybox
-        glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-
+        GLState &glState = GLState::Get();
+        {
+            ProfileScope scope("Skybox");
+            glState.DepthFunc(GL_LEQUAL);
+            skyboxShader.use();
 
-        skyboxShader.setFloat("coef", coef);
+            skyboxCoefUniform.set(coef);
 
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTextureFOM);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
+            glState.BindVertexArray(skyboxVAO);
+            glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, skyboxTexture);
+            glState.BindTexture(1, GL_TEXTURE_CUBE_MAP, skyboxTextureFOM);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glState.DepthFunc(GL_LESS);
+        }
 
+        frameStats.glState = glState.Counters();
+        glState.ResetCounters();
 
-        if (programState->ImGuiEnabled)
+        if (programState->ImGuiEnabled) {
+            ProfileScope scope("ImGui");
             DrawImGui(programState);
-
+        }
+        // swapping waits for the GPU, it is not part of the frame's own time
+        profiler.EndFrame();
+        // past the warm-up a benchmark frame should find everything it needs allocated; the report counts
+        // the frames that still allocate. The report itself grows after this.
+        frameStats.allocations = AllocationCounter::Count() - frameAllocationStart;
+        if (benchmark.enabled) {
+            // waiting for the GPU every frame is fine here and records every frame
+            profiler.Flush();
+            if (simulationClock.Steps() > (uint64_t) benchmark.warmupFrames)
+                benchmarkReport.AddFrame(profiler, frameStats.allocations);
+            if (simulationClock.Steps() >= (uint64_t) (benchmark.warmupFrames + benchmark.frames))
+                glfwSetWindowShouldClose(window, true);
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -534,7 +932,16 @@ int main() {
         glfwPollEvents();
     }
 
-    programState->SaveToFile("resources/program_state.txt");
+    if (!benchmark.recordInput.empty())
+        recordedInput.Save(benchmark.recordInput);
+    if (benchmark.enabled) {
+        std::ofstream report(benchmark.output);
+        benchmarkReport.WriteJson(report);
+        std::cout << "Benchmark: " << benchmarkReport.FrameCount() << " frames written to " << benchmark.output << ", "
+                  << benchmarkReport.AllocatingFrames() << " of them allocated from the heap" << std::endl;
+    } else if (!replaying) {
+        programState->SaveToFile("resources/program_state.txt");
+    }
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -545,32 +952,43 @@ int main() {
     return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// process all input: query GLFW whether relevant keys are pressed/released this frame and hand them to the
+// next simulation steps in pendingInput
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    int movementKeysPresed = 0;// fix the faster stepping
+    pendingInput.keys = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        movementKeysPresed++;
+        pendingInput.keys |= InputFrame::FORWARD_KEY;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        movementKeysPresed++;
+        pendingInput.keys |= InputFrame::BACKWARD_KEY;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        movementKeysPresed++;
+        pendingInput.keys |= InputFrame::LEFT_KEY;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        movementKeysPresed++;
-
-
+        pendingInput.keys |= InputFrame::RIGHT_KEY;
+}
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(FORWARD, deltaTime, movementKeysPresed);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(BACKWARD, deltaTime, movementKeysPresed);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(LEFT, deltaTime, movementKeysPresed);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(RIGHT, deltaTime, movementKeysPresed);
+// moves the camera by the input of one simulation step lasting seconds
+void applyInput(Camera &camera, const InputFrame &input, float seconds) {
+    int movementKeysPresed = 0;// fix the faster stepping
+    for (uint8_t key : {InputFrame::FORWARD_KEY, InputFrame::BACKWARD_KEY, InputFrame::LEFT_KEY, InputFrame::RIGHT_KEY})
+        if (input.keys & key)
+            movementKeysPresed++;
+
+    if (input.keys & InputFrame::FORWARD_KEY)
+        camera.ProcessKeyboard(FORWARD, seconds, movementKeysPresed);
+    if (input.keys & InputFrame::BACKWARD_KEY)
+        camera.ProcessKeyboard(BACKWARD, seconds, movementKeysPresed);
+    if (input.keys & InputFrame::LEFT_KEY)
+        camera.ProcessKeyboard(LEFT, seconds, movementKeysPresed);
+    if (input.keys & InputFrame::RIGHT_KEY)
+        camera.ProcessKeyboard(RIGHT, seconds, movementKeysPresed);
+    if (input.mouseX != 0.0f || input.mouseY != 0.0f)
+        camera.ProcessMouseMovement(input.mouseX, input.mouseY);
+    if (input.scroll != 0.0f)
+        camera.ProcessMouseScroll(input.scroll);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -596,14 +1014,46 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
     lastX = xpos;
     lastY = ypos;
 
-    if (programState->CameraMouseMovementUpdateEnabled)
-        programState->camera.ProcessMouseMovement(xoffset, yoffset);
+    if (programState->CameraMouseMovementUpdateEnabled) {
+        pendingInput.mouseX += xoffset;
+        pendingInput.mouseY += yoffset;
+    }
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-    programState->camera.ProcessMouseScroll(yoffset);
+    pendingInput.scroll += yoffset;
+}
+
+// one row per nesting level of the last profiled frame's scopes on the CPU or GPU clock, scaled to the
+// longer of the two frame times so both timelines line up
+void DrawProfilerTimeline(const Profiler& profiler, bool gpu) {
+    const std::vector<ProfileScopeResult>& scopes = profiler.Results();
+    float frameMs = std::max(std::max(profiler.FrameCpuMs(), profiler.FrameGpuMs()), 0.001f);
+    int rows = 1;
+    for (const ProfileScopeResult& scope : scopes)
+        rows = std::max(rows, scope.depth + 1);
+
+    ImGui::Text(gpu ? "GPU" : "CPU");
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = ImGui::GetContentRegionAvail().x;
+    float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + rows * rowHeight), IM_COL32(30, 30, 30, 255));
+    for (const ProfileScopeResult& scope : scopes) {
+        float start = gpu ? scope.gpuStart : scope.cpuStart;
+        float ms = gpu ? scope.gpuMs : scope.cpuMs;
+        ImVec2 min(origin.x + start / frameMs * width, origin.y + scope.depth * rowHeight);
+        ImVec2 max(std::max(min.x + 1.0f, origin.x + (start + ms) / frameMs * width), min.y + rowHeight - 1.0f);
+        drawList->AddRectFilled(min, max, ImColor::HSV(std::fmod(scope.track * 0.13f, 1.0f), 0.6f, 0.7f));
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32_WHITE, scope.name);
+        drawList->PopClipRect();
+        if (ImGui::IsMouseHoveringRect(min, max))
+            ImGui::SetTooltip("%s: %.3f ms", scope.name, ms);
+    }
+    ImGui::Dummy(ImVec2(width, rows * rowHeight));
 }
 
 void DrawImGui(ProgramState *programState) {
@@ -624,6 +1074,37 @@ void DrawImGui(ProgramState *programState) {
         ImGui::DragFloat("pointLight.constant", &programState->pointLight.constant, 0.05, 0.0, 1.0);
         ImGui::DragFloat("pointLight.linear", &programState->pointLight.linear, 0.05, 0.0, 1.0);
         ImGui::DragFloat("pointLight.quadratic", &programState->pointLight.quadratic, 0.05, 0.0, 1.0);
+
+        ImGui::Checkbox("Light stress test", &programState->lightStressTest);
+        ImGui::SliderInt("Stress lights", &programState->stressLightCount, 0, 1024);
+        ImGui::Text("Point lights: %u, cluster entries: %u", frameStats.pointLights, frameStats.clusterLightEntries);
+        ImGui::Checkbox("Deferred shading", &programState->deferredShading);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Profiler");
+        const Profiler& profiler = Profiler::Get();
+        ImGui::Text("Frame: CPU %.3f ms, GPU %.3f ms (%u frames dropped)", profiler.FrameCpuMs(), profiler.FrameGpuMs(),
+                    profiler.DroppedFrames());
+        DrawProfilerTimeline(profiler, false);
+        DrawProfilerTimeline(profiler, true);
+        static bool graphCpu = false;
+        ImGui::Checkbox("Graph CPU times", &graphCpu);
+        for (const Profiler::Track& track : profiler.Tracks()) {
+            const float* values = graphCpu ? track.cpuMs : track.gpuMs;
+            char overlay[32];
+            snprintf(overlay, sizeof(overlay), "%.3f ms", values[(profiler.HistoryOffset() + Profiler::HISTORY - 1) % Profiler::HISTORY]);
+            ImGui::PlotLines(track.name, values, Profiler::HISTORY, profiler.HistoryOffset(), overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+        }
+        ImGui::Checkbox("Depth pre-pass", &programState->depthPrepass);
+        ImGui::Checkbox("Sort draw calls", &programState->sortDraws);
+        ImGui::Checkbox("Per-model timings", &programState->perModelTimings);
+        const RenderQueueStats& queue = frameStats.renderQueue;
+        ImGui::Text("Draw packets: %u, state changes: %u (%u saved)", queue.packets, queue.stateChanges, queue.Saved());
+        ImGui::Text("GL state calls issued: %u, skipped: %u", frameStats.glState.issued, frameStats.glState.skipped);
+        ImGui::Text("Heap allocations: %llu, frame arena: %.1f KB", frameStats.allocations, frameStats.frameArenaBytes / 1024.0);
+        ImGui::Text("Transforms updated: %zu", frameStats.transformsUpdated);
         ImGui::End();
     }
 
@@ -634,11 +1115,37 @@ void DrawImGui(ProgramState *programState) {
         ImGui::Text("(Yaw, Pitch): (%f, %f)", c.Yaw, c.Pitch);
         ImGui::Text("Camera front: (%f, %f, %f)", c.Front.x, c.Front.y, c.Front.z);
         ImGui::Checkbox("Camera mouse update", &programState->CameraMouseMovementUpdateEnabled);
+        ImGui::Checkbox("Frustum culling", &programState->frustumCulling);
+        const CullStats& culling = frameStats.culling;
+        ImGui::Text("Objects drawn/culled: %u / %u", culling.objectsDrawn, culling.objectsCulled);
+        ImGui::Text("Meshes drawn/culled: %u / %u", culling.meshesDrawn, culling.meshesCulled);
+        ImGui::Checkbox("Occlusion culling", &programState->occlusionCulling);
+        ImGui::Text("Objects occluded: %u (%u queries)", culling.objectsOccluded, frameStats.occlusionQueries);
+        ImGui::Checkbox("Level of detail", &programState->levelOfDetail);
+        ImGui::Checkbox("LOD cross-fade", &programState->lodCrossFade);
+        ImGui::DragFloat("LOD pixel error", &programState->lodPixelError, 0.05f, 0.1f, 16.0f);
+        ImGui::Text("Triangles drawn: %u", culling.trianglesDrawn);
+        ImGui::Text("Vertex buffers: %.2f MB", frameStats.vertexBufferBytes / (1024.0f * 1024.0f));
+        ImGui::Text("Index buffers: %.2f MB", frameStats.indexBufferBytes / (1024.0f * 1024.0f));
+        for (GeometryArena::Layout layout: {GeometryArena::PACKED_VERTICES, GeometryArena::FLOAT_VERTICES}) {
+            const GeometryArena &arena = GeometryArena::ForLayout(layout);
+            ImGui::Text("%s arena: %.2f + %.2f MB", layout == GeometryArena::PACKED_VERTICES ? "Packed" : "Float",
+                        arena.VertexBytesUsed() / (1024.0f * 1024.0f), arena.IndexBytesUsed() / (1024.0f * 1024.0f));
+        }
+        const MaterialLibrary &materials = MaterialLibrary::Get();
+        ImGui::Text("Materials: %zu in %zu texture arrays, %.2f MB", materials.MaterialCount(), materials.ArrayCount(),
+                    materials.TextureBytes() / (1024.0f * 1024.0f));
+        ImGui::Checkbox("Tree impostors", &programState->impostors);
+        ImGui::DragFloat("Impostor distance", &programState->impostorDistance, 0.5f, 5.0f, 100.0f);
+        ImGui::Checkbox("Forest", &programState->forest);
+        ImGui::Text("Impostors drawn: %u", culling.impostorsDrawn);
         ImGui::End();
     }
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // the backend sets program, VAO, textures and blending directly
+    GLState::Get().Invalidate();
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
@@ -654,31 +1161,50 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         parallaxMappingToggle = !parallaxMappingToggle;
 
     }
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+        recordedCameraPath.Add(programState->camera);
+        recordedCameraPath.Save(RECORDED_CAMERA_PATH);
+        std::cout << "Camera key " << recordedCameraPath.KeyCount() << " saved to " << RECORDED_CAMERA_PATH << std::endl;
+    }
 }
 
-void placeModel(Shader& ourShader, Model& ourModel, float rotationAngle, glm::vec3 rotationDirection, glm::vec3 scalingVec, glm::vec3 translationVec, int index) {
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::translate(modelMatrix, translationVec);
-    modelMatrix = glm::scale(modelMatrix, scalingVec);
-    if(index != -1)
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(index*14.22f) , glm::vec3(0, 1, 0));
-    if(rotationAngle != 0.0)
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotationAngle) , rotationDirection);
-
-    ourShader.setMat4("model", modelMatrix);
-    ourModel.Draw(ourShader);
+Camera interpolateCamera(const Camera& from, const Camera& to, float alpha) {
+    Camera camera = to;
+    camera.Position = glm::mix(from.Position, to.Position, alpha);
+    camera.Zoom = glm::mix(from.Zoom, to.Zoom, alpha);
+    camera.SetOrientation(glm::mix(from.Yaw, to.Yaw, alpha), glm::mix(from.Pitch, to.Pitch, alpha));
+    return camera;
 }
 
+void placeModel(RenderQueue& queue, unsigned int pass, const RenderState& state, Model& ourModel, unsigned int occlusionId, const glm::mat4& modelMatrix) {
+    bool occlusionTested = programState->occlusionCulling && ourModel.IsReady();
+    if (occlusionTested && occlusionCuller->Test(occlusionId, ourModel.Box.Transformed(modelMatrix))) {
+        cullStats.objectsOccluded++;
+        return;
+    }
+    RenderState objectState = state;
+    if (occlusionTested)
+        objectState.conditionQuery = occlusionCuller->ConditionQuery(occlusionId);
+    ourModel.Enqueue(queue, pass, objectState, modelMatrix, cullingFrustum(), cullStats, lodSelection());
+}
 
-void placeModel(Shader& ourShader, Model& ourModel, float rotationAngle, glm::vec3 rotationDirection, glm::vec3 scalingVec, glm::vec3 translationVec) {
-    placeModel(ourShader, ourModel, rotationAngle, rotationDirection, scalingVec, translationVec, -1);
+// appends the instances whose last occlusion query did not find them hidden to visible, all of them when
+// occlusion culling is off; the ids of the instances follow firstOcclusionId in order
+void appendUnoccluded(const Model& model, unsigned int firstOcclusionId, const glm::mat4* instances, size_t count, std::vector<glm::mat4>& visible) {
+    bool occlusionTested = programState->occlusionCulling && model.IsReady();
+    for (size_t i = 0; i < count; i++) {
+        if (occlusionTested && occlusionCuller->Test(firstOcclusionId + i, model.Box.Transformed(instances[i])))
+            cullStats.objectsOccluded++;
+        else
+            visible.push_back(instances[i]);
+    }
 }
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++)
@@ -706,127 +1232,112 @@ unsigned int loadCubemap(vector<std::string> faces)
     return textureID;
 }
 
-void renderQuad(unsigned int &quadVAO, unsigned int &quadVBO)
+// framebuffer with an RGBA8 color and a depth/stencil renderbuffer, for rendering without a visible window
+unsigned int createOffscreenFramebuffer(int width, int height)
 {
-    if (quadVAO == 0)
-    {
-        // positions
-        glm::vec3 pos1(-30.0f,  8.0f, 0.0f);
-        glm::vec3 pos2(-30.0f, 0.0f, 0.0f);
-        glm::vec3 pos3( 30.0f, 0.0f, 0.0f);
-        glm::vec3 pos4( 30.0f,  8.0f, 0.0f);
-        // texture coordinates
-        glm::vec2 uv1(0.0f, 2.0f);
-        glm::vec2 uv2(0.0f, 0.0f);
-        glm::vec2 uv3(15.0f, 0.0f);
-        glm::vec2 uv4(15.0f, 2.0f);
-        // normal vector
-        glm::vec3 nm(0.0f, 0.0f, 1.0f);
-
-        // calculate tangent/bitangent vectors of both triangles
-        glm::vec3 tangent1, bitangent1;
-        glm::vec3 tangent2, bitangent2;
-        // triangle 1
-        // ----------
-        glm::vec3 edge1 = pos2 - pos1;
-        glm::vec3 edge2 = pos3 - pos1;
-        glm::vec2 deltaUV1 = uv2 - uv1;
-        glm::vec2 deltaUV2 = uv3 - uv1;
-
-        float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent1.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent1.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent1.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-        bitangent1.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent1.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent1.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-
-        // triangle 2
-        // ----------
-        edge1 = pos3 - pos1;
-        edge2 = pos4 - pos1;
-        deltaUV1 = uv3 - uv1;
-        deltaUV2 = uv4 - uv1;
-
-        f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent2.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent2.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent2.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-
-        bitangent2.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent2.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-
-
-        float quadVertices[] = {
-                // positions            // normal         // texcoords  // tangent                          // bitangent
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos4.x, pos4.y, pos4.z, nm.x, nm.y, nm.z, uv4.x, uv4.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z
-        };
-        // configure plane VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(8 * sizeof(float)));
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(11 * sizeof(float)));
-    }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    unsigned int framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Offscreen framebuffer is not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    return framebuffer;
 }
 
-unsigned int loadTexture(char const * path)
+// the wall quad as a mesh, two triangles with their own tangent frames, drawn packed like the models
+Mesh createWallMesh(const vector<Texture> &textures)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // positions
+    glm::vec3 pos1(-30.0f,  8.0f, 0.0f);
+    glm::vec3 pos2(-30.0f, 0.0f, 0.0f);
+    glm::vec3 pos3( 30.0f, 0.0f, 0.0f);
+    glm::vec3 pos4( 30.0f,  8.0f, 0.0f);
+    // texture coordinates
+    glm::vec2 uv1(0.0f, 2.0f);
+    glm::vec2 uv2(0.0f, 0.0f);
+    glm::vec2 uv3(15.0f, 0.0f);
+    glm::vec2 uv4(15.0f, 2.0f);
+    // normal vector
+    glm::vec3 nm(0.0f, 0.0f, 1.0f);
+
+    // calculate tangent/bitangent vectors of both triangles
+    glm::vec3 tangent1, bitangent1;
+    glm::vec3 tangent2, bitangent2;
+    // triangle 1
+    // ----------
+    glm::vec3 edge1 = pos2 - pos1;
+    glm::vec3 edge2 = pos3 - pos1;
+    glm::vec2 deltaUV1 = uv2 - uv1;
+    glm::vec2 deltaUV2 = uv3 - uv1;
+
+    float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+
+    tangent1.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
+    tangent1.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
+    tangent1.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
+
+    bitangent1.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
+    bitangent1.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
+    bitangent1.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
+
+    // triangle 2
+    // ----------
+    edge1 = pos3 - pos1;
+    edge2 = pos4 - pos1;
+    deltaUV1 = uv3 - uv1;
+    deltaUV2 = uv4 - uv1;
+
+    f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+
+    tangent2.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
+    tangent2.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
+    tangent2.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
+
+
+    bitangent2.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
+    bitangent2.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
+    bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
+
+
+    vector<Vertex> vertices = {
+            {pos1, nm, uv1, tangent1, bitangent1},
+            {pos2, nm, uv2, tangent1, bitangent1},
+            {pos3, nm, uv3, tangent1, bitangent1},
+
+            {pos1, nm, uv1, tangent2, bitangent2},
+            {pos3, nm, uv3, tangent2, bitangent2},
+            {pos4, nm, uv4, tangent2, bitangent2}
+    };
+    vector<unsigned int> indices = {0, 1, 2, 3, 4, 5};
+    return Mesh(vertices, indices, textures);
+}
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+// colored lights circling the scene at different radii and speeds, for stress testing the clustered lighting
+void appendStressLights(std::vector<PointLight>& lights, int count, float time) {
+    for (int i = 0; i < count; i++) {
+        // golden angle steps spread the lights evenly without storing any per-light state
+        float phase = 2.39996f * i;
+        float orbit = 3.0f + 25.0f * glm::fract(0.618034f * i);
+        float speed = (0.2f + 0.4f * glm::fract(0.414214f * i)) * (i % 2 ? 1.0f : -1.0f);
+        float angle = phase + speed * time;
+
+        PointLight light;
+        light.position = glm::vec3(orbit * glm::cos(angle), 1.0f + 1.5f * (1.0f + glm::sin(1.3f * time + phase)), orbit * glm::sin(angle));
+        glm::vec3 color = glm::vec3(0.5f + 0.5f * glm::cos(phase), 0.5f + 0.5f * glm::cos(phase + 2.094f), 0.5f + 0.5f * glm::cos(phase + 4.189f));
+        light.ambient = glm::vec3(0.0f);
+        light.diffuse = color;
+        light.specular = color;
+        light.constant = 1.0f;
+        light.linear = 0.7f;
+        light.quadratic = 1.8f;
+        lights.push_back(light);
     }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
 }
\ No newline at end of file
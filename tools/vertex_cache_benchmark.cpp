@@ -0,0 +1,85 @@
+// Reports the post-transform vertex cache efficiency of every model under resources/objects before and
+// after MeshOptimizer, per model summed over its meshes (full detail only):
+//   vertex_cache_benchmark [objects directory] [cache size]
+
+#include <learnopengl/model.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// .obj files below directory, sorted
+static void findModels(const std::string &directory, std::vector<std::string> &paths)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string path = directory + "/" + name;
+        if (entry->d_type == DT_DIR)
+            findModels(path, paths);
+        else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0)
+            paths.push_back(path);
+    }
+    closedir(dir);
+    std::sort(paths.begin(), paths.end());
+}
+
+static VertexCacheStats analyze(const std::vector<MeshData> &meshes, unsigned int cacheSize)
+{
+    VertexCacheStats total;
+    for (const MeshData &mesh: meshes) {
+        VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), cacheSize);
+        total.misses += stats.misses;
+        total.triangles += stats.triangles;
+        total.uniqueVertices += stats.uniqueVertices;
+    }
+    if (total.triangles > 0)
+        total.acmr = (float) total.misses / total.triangles;
+    if (total.uniqueVertices > 0)
+        total.atvr = (float) total.misses / total.uniqueVertices;
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    std::string directory = argc > 1 ? argv[1] : "resources/objects";
+    unsigned int cacheSize = argc > 2 ? (unsigned int) std::atoi(argv[2]) : MeshOptimizer::CACHE_SIZE;
+
+    std::vector<std::string> paths;
+    findModels(directory, paths);
+    if (paths.empty()) {
+        std::printf("no .obj files found below %s\n", directory.c_str());
+        return 1;
+    }
+
+    std::printf("FIFO cache of %u vertices\n", cacheSize);
+    std::printf("%-60s %10s %8s %8s %8s %8s %8s\n", "model", "triangles", "ACMR", "ACMR'", "ATVR", "ATVR'", "ms");
+    for (const std::string &path: paths) {
+        std::vector<MeshData> meshes;
+        if (!Model::ImportScene(path, meshes))
+            continue;
+        VertexCacheStats before = analyze(meshes, cacheSize);
+
+        auto start = std::chrono::steady_clock::now();
+        for (MeshData &mesh: meshes) {
+            std::vector<MeshLod> lods(1, MeshLod{0, (unsigned int) mesh.indices.size(), 0.0f});
+            MeshOptimizer::Optimize(mesh.vertices, mesh.indices, lods);
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        VertexCacheStats after = analyze(meshes, cacheSize);
+
+        std::printf("%-60s %10zu %8.3f %8.3f %8.3f %8.3f %8.1f\n", path.c_str(), before.triangles,
+                    before.acmr, after.acmr, before.atvr, after.atvr, milliseconds);
+    }
+    return 0;
+}